@@ -0,0 +1,854 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_ARCHIVE_H
+#define PANDEMIC_ARCHIVE_H
+
+#include <stdio.h>      // for fopen, fwrite, fread
+#include <stdlib.h>     // for malloc, realloc, free
+#include <string.h>     // for memcpy, memcmp, strerror
+#include <errno.h>      // for errno
+#include <pthread.h>    // for the writer thread
+#include <omp.h>       // OpenMP
+#ifdef ARCHIVE_ZLIB
+#include <zlib.h>       // for compress2, uncompress
+#endif
+
+/* Replay archive of every day of a run. With -z file, at the end of
+ * each day the threads copy the location, state and days infected of
+ * every person, by first id so a reordered run archives the same
+ * people, into one of two frames. A writer thread compares the frame
+ * with the day before, encodes it, compresses it with zlib (when built
+ * with -DARCHIVE_ZLIB) and appends it to the file, while the threads
+ * run the next day and fill the other frame.
+ *
+ * A day is either a key frame, every person in full, or a delta: a
+ * 4-bit move code per person (2 bits for each of x and y, the step + 1)
+ * and the people whose state or days infected changed. The first day
+ * and every ARCHIVE_KEYFRAME_DAYS-th day after it are key frames. An
+ * index of the days closes the file, so a reader finds a day and the
+ * key frame before it by binary search and applies at most
+ * ARCHIVE_KEYFRAME_DAYS - 1 deltas, without running the model.
+ *
+ * The archive does not depend on the layout of the build: coordinates
+ * and days are ints, states the chars of Defaults.h, and the counts and
+ * ids of people longs. */
+
+const char ARCHIVE_MAGIC[8] = {'P', 'A', 'N', 'D', 'A', 'R', 'C', 'H'};
+const int ARCHIVE_VERSION = 2;
+// A key frame every this many days bounds the deltas of a seek
+const int ARCHIVE_KEYFRAME_DAYS = 64;
+// zlib level of the days, fast rather than small
+const int ARCHIVE_LEVEL = 1;
+
+// First bytes of the archive, written again with the index at the end
+struct archive_header_t
+{
+    char magic[8];
+    int version;
+    int keyframe_days;
+    long number_of_people;
+    int environment_width;
+    int environment_height;
+    int compressed;
+    int first_day;
+    int num_days;
+    long index_offset;
+};
+
+// Entry of the index: where a day is and how it was encoded
+struct archive_entry_t
+{
+    int day;
+    int keyframe;
+    long offset;
+    long size;
+    long raw_size;
+};
+
+// Every person of a day, by first id
+struct archive_frame_t
+{
+    int *x_locations;
+    int *y_locations;
+    char *states;
+    int *num_days_infected;
+};
+
+// The writer of a run
+struct archive_t
+{
+    FILE *file;
+    struct archive_header_t header;
+    struct archive_entry_t *entries;
+    int capacity;
+    // the frames the threads fill in turn, and the day before, which
+    // only the writer uses
+    struct archive_frame_t frames[2];
+    int frame_days[2];
+    int pending[2];
+    struct archive_frame_t last;
+    // encoded and compressed day
+    char *raw;
+    char *packed;
+    long packed_capacity;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int stop;
+    // time the threads spent copying and waiting, time of the writer,
+    // and the bytes before and after compression
+    double copy_time;
+    double write_time;
+    long raw_bytes;
+    long written_bytes;
+};
+
+// The reader of an archive, holding the last day it decoded
+struct archive_reader_t
+{
+    FILE *file;
+    struct archive_header_t header;
+    struct archive_entry_t *entries;
+    struct archive_frame_t frame;
+    int current;
+    char *raw;
+    char *packed;
+};
+
+long        archive_frame_size(long number_of_people);
+long        archive_moves_size(long number_of_people);
+long        archive_raw_size(long number_of_people);
+void        archive_frame_allocate(struct archive_frame_t *frame,
+                long number_of_people);
+void        archive_frame_free(struct archive_frame_t *frame);
+void        archive_start(struct global_t *global, struct const_t *constant);
+void        archive_day(struct global_t *global, struct const_t *constant);
+void        archive_day_team(struct global_t *global,
+                struct const_t *constant, int day);
+void        *archive_writer(void *argument);
+long        archive_encode(struct archive_t *archive,
+                struct archive_frame_t *frame, int keyframe);
+void        archive_append(struct archive_t *archive, int day,
+                int keyframe, long raw_size);
+void        archive_finish(struct global_t *global, struct const_t *constant,
+                double day_time);
+int         archive_open(struct archive_reader_t *reader,
+                const char *file_name);
+int         archive_find(struct archive_reader_t *reader, int day,
+                int keyframe);
+int         archive_seek(struct archive_reader_t *reader, int day);
+int         archive_decode(struct archive_reader_t *reader, int entry);
+void        archive_close(struct archive_reader_t *reader);
+
+/*
+    archive_frame_size()
+        Returns the bytes of a key frame
+*/
+long archive_frame_size(long number_of_people)
+{
+    return(number_of_people * (3 * sizeof(int) + sizeof(char))
+        + sizeof(long));
+}
+
+/*
+    archive_moves_size()
+        Returns the bytes of the move codes of a day, rounded up to
+        whole longs so the longs after them are aligned
+*/
+long archive_moves_size(long number_of_people)
+{
+    return(((number_of_people + 1) / 2 + sizeof(long) - 1) / sizeof(long)
+        * sizeof(long));
+}
+
+/*
+    archive_raw_size()
+        Returns the most bytes an encoded day can take: a delta in which
+        every person changed, larger than a key frame by the move codes
+*/
+long archive_raw_size(long number_of_people)
+{
+    return(archive_moves_size(number_of_people) + sizeof(long)
+        + number_of_people * (sizeof(long) + sizeof(int) + sizeof(char)));
+}
+
+/*
+    archive_frame_allocate()
+        Allocates the arrays of a frame
+*/
+void archive_frame_allocate(struct archive_frame_t *frame,
+    long number_of_people)
+{
+    frame->x_locations = (int*)malloc(number_of_people * sizeof(int));
+    frame->y_locations = (int*)malloc(number_of_people * sizeof(int));
+    frame->states = (char*)malloc(number_of_people * sizeof(char));
+    frame->num_days_infected = (int*)malloc(number_of_people * sizeof(int));
+}
+
+/*
+    archive_frame_free()
+        Frees the arrays of a frame
+*/
+void archive_frame_free(struct archive_frame_t *frame)
+{
+    free(frame->x_locations);
+    free(frame->y_locations);
+    free(frame->states);
+    free(frame->num_days_infected);
+}
+
+/*
+    archive_start()
+        Opens the archive of -z, writes a header to be completed at the
+        end and starts the writer thread
+*/
+void archive_start(struct global_t *global, struct const_t *constant)
+{
+    struct archive_t *archive;
+    person_t number_of_people = global->number_of_people;
+
+    if(constant->archive_file == NULL)
+    {
+        return;
+    }
+
+    archive = (struct archive_t*)malloc(sizeof(struct archive_t));
+    archive->file = fopen(constant->archive_file, "wb");
+    if(archive->file == NULL)
+    {
+        fprintf(stderr, "ERROR: cannot write the archive to %s: %s\n",
+            constant->archive_file, strerror(errno));
+        exit(-1);
+    }
+
+    memset(&archive->header, 0, sizeof(archive->header));
+    memcpy(archive->header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    archive->header.version = ARCHIVE_VERSION;
+    archive->header.number_of_people = number_of_people;
+    archive->header.environment_width = constant->environment_width;
+    archive->header.environment_height = constant->environment_height;
+    archive->header.keyframe_days = ARCHIVE_KEYFRAME_DAYS;
+    #ifdef ARCHIVE_ZLIB
+    archive->header.compressed = 1;
+    #endif
+    archive->header.first_day = global->current_day;
+    fwrite(&archive->header, sizeof(archive->header), 1, archive->file);
+
+    archive->capacity = constant->total_number_of_days + 1;
+    archive->entries = (struct archive_entry_t*)malloc(archive->capacity
+        * sizeof(struct archive_entry_t));
+    archive_frame_allocate(&archive->frames[0], number_of_people);
+    archive_frame_allocate(&archive->frames[1], number_of_people);
+    archive_frame_allocate(&archive->last, number_of_people);
+    archive->pending[0] = 0;
+    archive->pending[1] = 0;
+    archive->raw = (char*)malloc(archive_raw_size(number_of_people));
+    #ifdef ARCHIVE_ZLIB
+    archive->packed_capacity = compressBound(
+        archive_raw_size(number_of_people));
+    archive->packed = (char*)malloc(archive->packed_capacity);
+    #else
+    archive->packed_capacity = 0;
+    archive->packed = NULL;
+    #endif
+    archive->stop = 0;
+    archive->copy_time = 0.0;
+    archive->write_time = 0.0;
+    archive->raw_bytes = 0;
+    archive->written_bytes = 0;
+    pthread_mutex_init(&archive->lock, NULL);
+    pthread_cond_init(&archive->changed, NULL);
+    pthread_create(&archive->writer, NULL, archive_writer, archive);
+
+    global->archive = archive;
+}
+
+/*
+    archive_day()
+        At the end of a day, each process spawns threads to copy the
+        people into a frame for the writer
+*/
+void archive_day(struct global_t *global, struct const_t *constant)
+{
+    int day = global->current_day;
+
+    if(global->archive != NULL)
+    {
+        #ifdef _OPENMP
+        #pragma omp parallel
+        #endif
+        archive_day_team(global, constant, day);
+    }
+}
+
+/*
+    archive_day_team()
+        The threads of the current team wait for the writer to be done
+        with the frame of two days ago, copy the people into it by first
+        id and hand it to the writer. Called by every thread of a
+        parallel region, with the day each thread ran.
+*/
+void archive_day_team(struct global_t *global, struct const_t *constant,
+    int day)
+{
+    struct archive_t *archive = global->archive;
+    struct archive_frame_t *frame;
+    int slot;
+    person_t current_person_id;
+    person_t *person_ids = global->person_ids;
+    days_t *num_days_infected = global->num_days_infected;
+    double start_archive = 0.0;
+
+    if(archive == NULL)
+    {
+        return;
+    }
+    slot = (day - archive->header.first_day) & 1;
+
+    #ifdef _OPENMP
+    #pragma omp master
+    #endif
+    start_archive = omp_get_wtime();
+
+    #ifdef _OPENMP
+    #pragma omp single
+    #endif
+    {
+    pthread_mutex_lock(&archive->lock);
+    while(archive->pending[slot])
+    {
+        pthread_cond_wait(&archive->changed, &archive->lock);
+    }
+    pthread_mutex_unlock(&archive->lock);
+    }
+
+    frame = &archive->frames[slot];
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id
+        <= global->number_of_people - 1; current_person_id++)
+    {
+        person_t id = person_ids[current_person_id];
+
+        frame->x_locations[id] = person_x(global, current_person_id);
+        frame->y_locations[id] = person_y(global, current_person_id);
+        frame->states[id] = person_state(global, current_person_id);
+        frame->num_days_infected[id] = num_days_infected[current_person_id];
+    }
+
+    #ifdef _OPENMP
+    #pragma omp single
+    #endif
+    {
+    pthread_mutex_lock(&archive->lock);
+    archive->frame_days[slot] = day;
+    archive->pending[slot] = 1;
+    pthread_cond_broadcast(&archive->changed);
+    pthread_mutex_unlock(&archive->lock);
+    }
+
+    #ifdef _OPENMP
+    #pragma omp master
+    #endif
+    archive->copy_time += omp_get_wtime() - start_archive;
+}
+
+/*
+    archive_writer()
+        The writer thread encodes and writes the frames in the order of
+        their days until it is stopped and has none left
+*/
+void *archive_writer(void *argument)
+{
+    struct archive_t *archive = (struct archive_t*)argument;
+    struct archive_frame_t swap;
+    int slot = 0;
+    int num_days = 0;
+
+    pthread_mutex_lock(&archive->lock);
+    while(1)
+    {
+        while(!archive->pending[slot] && !archive->stop)
+        {
+            pthread_cond_wait(&archive->changed, &archive->lock);
+        }
+        if(!archive->pending[slot])
+        {
+            break;
+        }
+        pthread_mutex_unlock(&archive->lock);
+
+        double start_write = omp_get_wtime();
+        int keyframe = num_days % ARCHIVE_KEYFRAME_DAYS == 0;
+        long raw_size = archive_encode(archive, &archive->frames[slot],
+            keyframe);
+
+        archive_append(archive, archive->frame_days[slot], keyframe,
+            raw_size);
+        num_days++;
+
+        // the frame is the day before of the next one
+        swap = archive->last;
+        archive->last = archive->frames[slot];
+
+        pthread_mutex_lock(&archive->lock);
+        archive->frames[slot] = swap;
+        archive->write_time += omp_get_wtime() - start_write;
+        archive->pending[slot] = 0;
+        pthread_cond_broadcast(&archive->changed);
+        slot ^= 1;
+    }
+    pthread_mutex_unlock(&archive->lock);
+
+    return(NULL);
+}
+
+/*
+    archive_encode()
+        Encodes the frame into the raw buffer, in full or as the changes
+        from the day before. Returns the size of the encoded day.
+*/
+long archive_encode(struct archive_t *archive, struct archive_frame_t *frame,
+    int keyframe)
+{
+    struct archive_frame_t *last = &archive->last;
+    long number_of_people = archive->header.number_of_people;
+    char *raw = archive->raw;
+    long size = 0;
+    long current_person_id;
+
+    if(keyframe)
+    {
+        memcpy(raw + size, frame->x_locations, number_of_people * sizeof(int));
+        size += number_of_people * sizeof(int);
+        memcpy(raw + size, frame->y_locations, number_of_people * sizeof(int));
+        size += number_of_people * sizeof(int);
+        memcpy(raw + size, frame->states, number_of_people * sizeof(char));
+        size += number_of_people * sizeof(char);
+        memcpy(raw + size, frame->num_days_infected,
+            number_of_people * sizeof(int));
+        size += number_of_people * sizeof(int);
+        return(size);
+    }
+
+    // Two moves a byte, the low nibble first
+    unsigned char *moves = (unsigned char*)raw;
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        int code = (frame->x_locations[current_person_id]
+            - last->x_locations[current_person_id] + 1)
+            | (frame->y_locations[current_person_id]
+            - last->y_locations[current_person_id] + 1) << 2;
+
+        if(current_person_id % 2 == 0)
+        {
+            moves[current_person_id / 2] = code;
+        }
+        else
+        {
+            moves[current_person_id / 2] |= code << 4;
+        }
+    }
+    size = archive_moves_size(number_of_people);
+
+    // The changed people: the count, then the gaps between their ids,
+    // their days infected and their states
+    long num_changed = 0;
+    long *ids = (long*)(raw + size + sizeof(long));
+    long last_id = 0;
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        if(frame->states[current_person_id]
+            != last->states[current_person_id]
+            || frame->num_days_infected[current_person_id]
+            != last->num_days_infected[current_person_id])
+        {
+            ids[num_changed] = current_person_id - last_id;
+            last_id = current_person_id;
+            num_changed++;
+        }
+    }
+    memcpy(raw + size, &num_changed, sizeof(long));
+    size += sizeof(long) + num_changed * sizeof(long);
+
+    int *days = (int*)(raw + size);
+    char *states = (char*)(days + num_changed);
+    long id = 0;
+    long current;
+    for(current = 0; current <= num_changed - 1; current++)
+    {
+        id += ids[current];
+        states[current] = frame->states[id];
+        days[current] = frame->num_days_infected[id];
+    }
+    size += num_changed * (sizeof(int) + sizeof(char));
+
+    return(size);
+}
+
+/*
+    archive_append()
+        Compresses the encoded day, writes it and adds it to the index
+*/
+void archive_append(struct archive_t *archive, int day, int keyframe,
+    long raw_size)
+{
+    struct archive_entry_t *entry;
+    char *data = archive->raw;
+    long size = raw_size;
+
+    #ifdef ARCHIVE_ZLIB
+    uLongf packed_size = archive->packed_capacity;
+    int status = compress2((Bytef*)archive->packed, &packed_size,
+        (Bytef*)archive->raw, raw_size, ARCHIVE_LEVEL);
+
+    if(status != Z_OK)
+    {
+        fprintf(stderr, "ERROR: cannot compress day %d of the archive (zlib error %d)\n",
+            day, status);
+        exit(-1);
+    }
+    data = archive->packed;
+    size = packed_size;
+    #endif
+
+    if(archive->header.num_days == archive->capacity)
+    {
+        archive->capacity *= 2;
+        archive->entries = (struct archive_entry_t*)realloc(archive->entries,
+            archive->capacity * sizeof(struct archive_entry_t));
+    }
+    entry = &archive->entries[archive->header.num_days];
+    entry->day = day;
+    entry->keyframe = keyframe;
+    entry->offset = ftell(archive->file);
+    entry->size = size;
+    entry->raw_size = raw_size;
+    archive->header.num_days++;
+
+    fwrite(data, 1, size, archive->file);
+    archive->raw_bytes += raw_size;
+    archive->written_bytes += size;
+}
+
+/*
+    archive_finish()
+        Stops the writer once it has written every day, writes the index
+        and the complete header, and reports the size of the archive
+        against full dumps of every day
+*/
+void archive_finish(struct global_t *global, struct const_t *constant,
+    double day_time)
+{
+    struct archive_t *archive = global->archive;
+    double start_finish = omp_get_wtime();
+
+    if(archive == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&archive->lock);
+    archive->stop = 1;
+    pthread_cond_broadcast(&archive->changed);
+    pthread_mutex_unlock(&archive->lock);
+    pthread_join(archive->writer, NULL);
+    archive->copy_time += omp_get_wtime() - start_finish;
+
+    archive->header.index_offset = ftell(archive->file);
+    fwrite(archive->entries, sizeof(struct archive_entry_t),
+        archive->header.num_days, archive->file);
+    fseek(archive->file, 0, SEEK_SET);
+    fwrite(&archive->header, sizeof(archive->header), 1, archive->file);
+    fclose(archive->file);
+
+    double dump_bytes = (double)archive->header.num_days
+        * archive_frame_size(archive->header.number_of_people);
+    printf("Archive: %d days in %.2lf MB (%.1lf%% of full dumps, %.2lf MB encoded), copy time %lf (%.2lf%% of the days), writer time %lf\n",
+        archive->header.num_days, archive->written_bytes / 1048576.0,
+        dump_bytes > 0.0 ? 100.0 * archive->written_bytes / dump_bytes : 0.0,
+        archive->raw_bytes / 1048576.0, archive->copy_time,
+        day_time > 0.0 ? 100.0 * archive->copy_time / day_time : 0.0,
+        archive->write_time);
+
+    pthread_mutex_destroy(&archive->lock);
+    pthread_cond_destroy(&archive->changed);
+    archive_frame_free(&archive->frames[0]);
+    archive_frame_free(&archive->frames[1]);
+    archive_frame_free(&archive->last);
+    free(archive->entries);
+    free(archive->raw);
+    free(archive->packed);
+    free(archive);
+    global->archive = NULL;
+}
+
+/*
+    archive_open()
+        Reads the header and the index of an archive. Returns 0, or -1
+        if the file is not an archive this build can read.
+*/
+int archive_open(struct archive_reader_t *reader, const char *file_name)
+{
+    struct archive_header_t *header = &reader->header;
+
+    reader->file = fopen(file_name, "rb");
+    if(reader->file == NULL)
+    {
+        fprintf(stderr, "ERROR: cannot read the archive %s: %s\n",
+            file_name, strerror(errno));
+        return(-1);
+    }
+    if(fread(header, sizeof(*header), 1, reader->file) != 1
+        || memcmp(header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0
+        || header->version != ARCHIVE_VERSION
+        || header->index_offset == 0)
+    {
+        fprintf(stderr, "ERROR: %s is not a complete version %d archive\n",
+            file_name, ARCHIVE_VERSION);
+        fclose(reader->file);
+        return(-1);
+    }
+    #ifndef ARCHIVE_ZLIB
+    if(header->compressed)
+    {
+        fprintf(stderr, "ERROR: %s is compressed, build with -DARCHIVE_ZLIB to read it\n",
+            file_name);
+        fclose(reader->file);
+        return(-1);
+    }
+    #endif
+
+    reader->entries = (struct archive_entry_t*)malloc(header->num_days
+        * sizeof(struct archive_entry_t));
+    fseek(reader->file, header->index_offset, SEEK_SET);
+    if(fread(reader->entries, sizeof(struct archive_entry_t),
+        header->num_days, reader->file) != (size_t)header->num_days)
+    {
+        fprintf(stderr, "ERROR: the index of %s is cut short\n", file_name);
+        free(reader->entries);
+        fclose(reader->file);
+        return(-1);
+    }
+
+    // room for the largest day, before and after compression
+    long packed_size = 0;
+    int entry;
+    for(entry = 0; entry <= header->num_days - 1; entry++)
+    {
+        if(reader->entries[entry].size > packed_size)
+        {
+            packed_size = reader->entries[entry].size;
+        }
+    }
+
+    archive_frame_allocate(&reader->frame, header->number_of_people);
+    reader->current = -1;
+    reader->raw = (char*)malloc(archive_raw_size(header->number_of_people));
+    reader->packed = (char*)malloc(packed_size);
+    return(0);
+}
+
+/*
+    archive_find()
+        Returns the last entry of the index at or before the day, the
+        last key frame if keyframe is set, -1 if there is none. The
+        entries are in the order of their days.
+*/
+int archive_find(struct archive_reader_t *reader, int day, int keyframe)
+{
+    int low = 0;
+    int high = reader->header.num_days - 1;
+    int found = -1;
+
+    // the last entry at or before the day
+    while(low <= high)
+    {
+        int middle = (low + high) / 2;
+
+        if(reader->entries[middle].day <= day)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    // key frames are every keyframe_days-th entry
+    if(keyframe && found >= 0)
+    {
+        found -= found % reader->header.keyframe_days;
+    }
+    return(found);
+}
+
+/*
+    archive_seek()
+        Decodes the day into reader->frame, from the key frame before it
+        or from the day the reader holds if that is closer. Returns 0,
+        or -1 if the archive does not have the day.
+*/
+int archive_seek(struct archive_reader_t *reader, int day)
+{
+    int target = archive_find(reader, day, 0);
+    int entry = archive_find(reader, day, 1);
+
+    if(target < 0 || reader->entries[target].day != day)
+    {
+        return(-1);
+    }
+    if(reader->current >= entry && reader->current <= target)
+    {
+        entry = reader->current + 1;
+    }
+    for(; entry <= target; entry++)
+    {
+        if(archive_decode(reader, entry) != 0)
+        {
+            return(-1);
+        }
+    }
+    return(0);
+}
+
+/*
+    archive_decode()
+        Reads an entry and applies it to reader->frame, which must hold
+        the entry before unless the entry is a key frame. Returns 0, or
+        -1 if the entry cannot be read.
+*/
+int archive_decode(struct archive_reader_t *reader, int entry)
+{
+    struct archive_entry_t *index = &reader->entries[entry];
+    struct archive_frame_t *frame = &reader->frame;
+    long number_of_people = reader->header.number_of_people;
+    char *raw = reader->raw;
+    long size = 0;
+    long current_person_id;
+
+    // an entry larger than any day the people can make is not read
+    if(index->raw_size > archive_raw_size(number_of_people)
+        || (!reader->header.compressed && index->size != index->raw_size))
+    {
+        return(-1);
+    }
+
+    fseek(reader->file, index->offset, SEEK_SET);
+    #ifdef ARCHIVE_ZLIB
+    if(reader->header.compressed)
+    {
+        uLongf raw_size = index->raw_size;
+
+        if(fread(reader->packed, 1, index->size, reader->file)
+            != (size_t)index->size
+            || uncompress((Bytef*)raw, &raw_size, (Bytef*)reader->packed,
+            index->size) != Z_OK
+            || (long)raw_size != index->raw_size)
+        {
+            return(-1);
+        }
+    }
+    else
+    #endif
+    if(fread(raw, 1, index->size, reader->file) != (size_t)index->size)
+    {
+        return(-1);
+    }
+
+    if(index->keyframe)
+    {
+        if(index->raw_size != number_of_people
+            * (long)(3 * sizeof(int) + sizeof(char)))
+        {
+            return(-1);
+        }
+        memcpy(frame->x_locations, raw + size, number_of_people * sizeof(int));
+        size += number_of_people * sizeof(int);
+        memcpy(frame->y_locations, raw + size, number_of_people * sizeof(int));
+        size += number_of_people * sizeof(int);
+        memcpy(frame->states, raw + size, number_of_people * sizeof(char));
+        size += number_of_people * sizeof(char);
+        memcpy(frame->num_days_infected, raw + size,
+            number_of_people * sizeof(int));
+        reader->current = entry;
+        return(0);
+    }
+
+    // The changed people must fill the rest of the day and their ids
+    // must be people of the archive, checked before the frame changes
+    long num_changed;
+    size = archive_moves_size(number_of_people);
+    if(index->raw_size < size + (long)sizeof(long))
+    {
+        return(-1);
+    }
+    memcpy(&num_changed, raw + size, sizeof(long));
+    size += sizeof(long);
+    if(num_changed < 0 || num_changed > number_of_people
+        || index->raw_size != size + num_changed
+        * (long)(sizeof(long) + sizeof(int) + sizeof(char)))
+    {
+        return(-1);
+    }
+    long *ids = (long*)(raw + size);
+    int *days = (int*)(ids + num_changed);
+    char *states = (char*)(days + num_changed);
+    long id = 0;
+    long current;
+    for(current = 0; current <= num_changed - 1; current++)
+    {
+        if(ids[current] < 0 || ids[current] > number_of_people - 1 - id)
+        {
+            return(-1);
+        }
+        id += ids[current];
+    }
+
+    unsigned char *moves = (unsigned char*)raw;
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        int code = moves[current_person_id / 2]
+            >> (current_person_id % 2 * 4);
+
+        frame->x_locations[current_person_id] += (code & 3) - 1;
+        frame->y_locations[current_person_id] += (code >> 2 & 3) - 1;
+    }
+
+    id = 0;
+    for(current = 0; current <= num_changed - 1; current++)
+    {
+        id += ids[current];
+        frame->states[id] = states[current];
+        frame->num_days_infected[id] = days[current];
+    }
+
+    reader->current = entry;
+    return(0);
+}
+
+/*
+    archive_close()
+        Closes the archive and frees the reader
+*/
+void archive_close(struct archive_reader_t *reader)
+{
+    fclose(reader->file);
+    archive_frame_free(&reader->frame);
+    free(reader->entries);
+    free(reader->raw);
+    free(reader->packed);
+}
+
+#endif
@@ -0,0 +1,657 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_CHECKPOINT_H
+#define PANDEMIC_CHECKPOINT_H
+
+#include <stdio.h>      // for fprintf, rename
+#include <stdlib.h>     // for malloc, free, exit
+#include <string.h>     // for memcpy, memcmp, strerror
+#include <errno.h>      // for errno
+#include <fcntl.h>      // for open
+#include <unistd.h>     // for write, fsync, close
+#include <pthread.h>    // for the writer thread
+#include <sys/mman.h>   // for mmap
+#include <sys/stat.h>   // for fstat
+#include <omp.h>       // OpenMP
+
+/* Checkpoint and restart. With -k days, at the end of every days-th
+ * day the threads copy the people into a buffer laid out as the
+ * snapshot file, and a writer thread writes the buffer while the next
+ * days run; the compute threads only wait if the writer has not
+ * finished the previous snapshot. The file is written next to its
+ * name and renamed, so a crash leaves the last complete snapshot.
+ *
+ * A snapshot is a header page (the counters of global_t, const_t and
+ * stats_t) followed by the arrays that carry over from one day to the
+ * next, each on its own pages. The random numbers are keyed on the
+ * seed, the day and the first ids, so the seed and the day are all the
+ * state they have. -R file maps the snapshot privately and points the
+ * arrays into the mapping, so a restart reads only the pages the run
+ * touches, and carries on from the day after the snapshot with the
+ * same results as a run that never stopped. */
+
+// Version of the snapshot file, changed whenever its layout changes
+const char SNAPSHOT_MAGIC[8] = {'P', 'A', 'N', 'D', 'E', 'M', 'I', 'C'};
+const int SNAPSHOT_VERSION = 2;
+const long SNAPSHOT_ALIGN = 4096;
+
+// Arrays of a snapshot: the locations (x and y, or the packed ones
+// and nothing), states, days infected, first ids, active infected
+// list, and the stamps and raster of the infection field
+const int NUM_SNAPSHOT_ARRAYS = 9;
+
+// First page of a snapshot
+struct snapshot_header_t
+{
+    char magic[8];
+    int version;
+    // the build must match: layout of people, size of an id, sizes of
+    // the structs
+    int compact_layout;
+    int id_size;
+    int const_size;
+    int stats_size;
+    // counters of global_t; current_day is the next day to run
+    int current_day;
+    long number_of_people;
+    long num_initially_infected;
+    long num_infected;
+    long num_susceptible;
+    long num_immune;
+    long num_dead;
+    long num_tile_checks;
+    long num_tile_skips;
+    // where each array starts in the file and its size in bytes, 0 if
+    // the snapshot does not have it
+    long offsets[NUM_SNAPSHOT_ARRAYS];
+    long sizes[NUM_SNAPSHOT_ARRAYS];
+    long total_size;
+    struct const_t constant;
+    struct stats_t stats;
+};
+
+// State of the writer thread
+struct checkpoint_t
+{
+    // the copy of a day, laid out as the file
+    char *buffer;
+    struct snapshot_header_t *header;
+    const char *file_name;
+    // the writer waits for pending, the compute threads wait for it
+    // to be cleared
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int pending;
+    int stop;
+    // time the compute threads spent copying and waiting, time the
+    // writer spent writing, and the snapshots written
+    double copy_time;
+    double write_time;
+    int num_written;
+};
+
+void        checkpoint_fields(struct global_t *global,
+                struct const_t *constant, void ***fields, long *sizes);
+long        checkpoint_align(long size);
+void        checkpoint_start(struct global_t *global,
+                struct const_t *constant);
+int         checkpoint_due(struct global_t *global, struct const_t *constant,
+                int day);
+void        checkpoint_day(struct global_t *global, struct const_t *constant,
+                struct stats_t *stats);
+void        checkpoint_day_team(struct global_t *global,
+                struct const_t *constant, struct stats_t *stats, int day);
+void        checkpoint_copy_team(struct global_t *global,
+                struct const_t *constant, struct stats_t *stats, int day);
+void        *checkpoint_writer(void *argument);
+int         write_snapshot(const char *file_name, char *buffer, long size);
+void        checkpoint_finish(struct global_t *global);
+void        checkpoint_report(struct global_t *global, double day_time);
+void        checkpoint_open(struct global_t *global,
+                struct const_t *constant, struct stats_t *stats);
+void        checkpoint_map_arrays(struct global_t *global,
+                struct const_t *constant);
+void        release_array(struct global_t *global, void *array);
+void        checkpoint_cleanup(struct global_t *global);
+
+/*
+    checkpoint_fields()
+        Gives the address of the pointer of every array of a snapshot
+        in global and the size of the array, NULL and 0 for the arrays
+        the run does not have
+*/
+void checkpoint_fields(struct global_t *global, struct const_t *constant,
+    void ***fields, long *sizes)
+{
+    long number_of_people = global->number_of_people;
+    int current;
+
+    for(current = 0; current <= NUM_SNAPSHOT_ARRAYS - 1; current++)
+    {
+        fields[current] = NULL;
+        sizes[current] = 0;
+    }
+
+    #ifdef COMPACT_LAYOUT
+    fields[0] = (void**)&global->locations;
+    sizes[0] = number_of_people * sizeof(unsigned int);
+    fields[2] = (void**)&global->states;
+    sizes[2] = (number_of_people + 3) / 4;
+    #else
+    fields[0] = (void**)&global->x_locations;
+    sizes[0] = number_of_people * sizeof(int);
+    fields[1] = (void**)&global->y_locations;
+    sizes[1] = number_of_people * sizeof(int);
+    fields[2] = (void**)&global->states;
+    sizes[2] = number_of_people * sizeof(char);
+    #endif
+    fields[3] = (void**)&global->num_days_infected;
+    sizes[3] = number_of_people * sizeof(days_t);
+    fields[4] = (void**)&global->person_ids;
+    sizes[4] = number_of_people * sizeof(person_t);
+    fields[5] = (void**)&global->infected_ids;
+    sizes[5] = number_of_people * sizeof(person_t);
+
+    // The infection field is the only engine kept from day to day
+    if(constant->contact_engine == ENGINE_FIELD)
+    {
+        fields[6] = (void**)&global->stamped_x_locations;
+        sizes[6] = number_of_people * sizeof(int);
+        fields[7] = (void**)&global->stamped_y_locations;
+        sizes[7] = number_of_people * sizeof(int);
+        fields[8] = (void**)&global->infection_raster;
+        sizes[8] = (long)constant->environment_width
+            * constant->environment_height * sizeof(int);
+    }
+}
+
+/*
+    checkpoint_align()
+        Rounds the size up to whole pages
+*/
+long checkpoint_align(long size)
+{
+    return((size + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN);
+}
+
+/*
+    checkpoint_start()
+        Lays out the snapshot, allocates the buffer and starts the
+        writer thread
+*/
+void checkpoint_start(struct global_t *global, struct const_t *constant)
+{
+    struct checkpoint_t *checkpoint;
+    struct snapshot_header_t layout;
+    void **fields[NUM_SNAPSHOT_ARRAYS];
+    long offset = checkpoint_align(sizeof(struct snapshot_header_t));
+    int current;
+
+    if(constant->checkpoint_days <= 0)
+    {
+        return;
+    }
+
+    // Every array starts on a page, so a restart can map it
+    memset(&layout, 0, sizeof(layout));
+    checkpoint_fields(global, constant, fields, layout.sizes);
+    for(current = 0; current <= NUM_SNAPSHOT_ARRAYS - 1; current++)
+    {
+        if(layout.sizes[current] > 0)
+        {
+            layout.offsets[current] = offset;
+            offset = checkpoint_align(offset + layout.sizes[current]);
+        }
+    }
+    layout.total_size = offset;
+
+    checkpoint = (struct checkpoint_t*)malloc(sizeof(struct checkpoint_t));
+    checkpoint->buffer = (char*)calloc(layout.total_size, 1);
+    checkpoint->header = (struct snapshot_header_t*)checkpoint->buffer;
+    *checkpoint->header = layout;
+    checkpoint->file_name = constant->checkpoint_file;
+    checkpoint->pending = 0;
+    checkpoint->stop = 0;
+    checkpoint->copy_time = 0.0;
+    checkpoint->write_time = 0.0;
+    checkpoint->num_written = 0;
+    pthread_mutex_init(&checkpoint->lock, NULL);
+    pthread_cond_init(&checkpoint->changed, NULL);
+    pthread_create(&checkpoint->writer, NULL, checkpoint_writer, checkpoint);
+
+    global->checkpoint = checkpoint;
+}
+
+/*
+    checkpoint_due()
+        Returns 1 if a snapshot is taken at the end of the day
+*/
+int checkpoint_due(struct global_t *global, struct const_t *constant, int day)
+{
+    return(global->checkpoint != NULL
+        && (day + 1) % constant->checkpoint_days == 0);
+}
+
+/*
+    checkpoint_day()
+        At the end of a day, each process spawns threads to copy the
+        people for the writer if a snapshot is due
+*/
+void checkpoint_day(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats)
+{
+    int day = global->current_day;
+
+    if(checkpoint_due(global, constant, day))
+    {
+        #ifdef _OPENMP
+        #pragma omp parallel
+        #endif
+        checkpoint_day_team(global, constant, stats, day);
+    }
+}
+
+/*
+    checkpoint_day_team()
+        The threads of the current team wait for the writer to finish
+        the last snapshot, copy the people into its buffer and hand it
+        the buffer, if a snapshot is due at the end of the day. Called
+        by every thread of a parallel region, with the day each thread
+        ran: global->current_day may already be the next one.
+*/
+void checkpoint_day_team(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats, int day)
+{
+    struct checkpoint_t *checkpoint = global->checkpoint;
+    double start_checkpoint = 0.0;
+
+    if(!checkpoint_due(global, constant, day))
+    {
+        return;
+    }
+
+    #ifdef _OPENMP
+    #pragma omp master
+    #endif
+    start_checkpoint = omp_get_wtime();
+
+    #ifdef _OPENMP
+    #pragma omp single
+    #endif
+    {
+    pthread_mutex_lock(&checkpoint->lock);
+    while(checkpoint->pending)
+    {
+        pthread_cond_wait(&checkpoint->changed, &checkpoint->lock);
+    }
+    pthread_mutex_unlock(&checkpoint->lock);
+    }
+
+    checkpoint_copy_team(global, constant, stats, day);
+
+    #ifdef _OPENMP
+    #pragma omp single
+    #endif
+    {
+    pthread_mutex_lock(&checkpoint->lock);
+    checkpoint->pending = 1;
+    pthread_cond_broadcast(&checkpoint->changed);
+    pthread_mutex_unlock(&checkpoint->lock);
+    }
+
+    #ifdef _OPENMP
+    #pragma omp master
+    #endif
+    checkpoint->copy_time += omp_get_wtime() - start_checkpoint;
+}
+
+/*
+    checkpoint_copy_team()
+        Each thread of the team copies its block of every array into
+        the buffer, and one of them the counters. Only the people on
+        the active infected list are copied from it.
+*/
+void checkpoint_copy_team(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats, int day)
+{
+    struct snapshot_header_t *header = global->checkpoint->header;
+    void **fields[NUM_SNAPSHOT_ARRAYS];
+    long sizes[NUM_SNAPSHOT_ARRAYS];
+    int rank = 0;
+    int threads = 1;
+    int current;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    threads = omp_get_num_threads();
+    #endif
+
+    checkpoint_fields(global, constant, fields, sizes);
+    sizes[5] = (long)global->num_infected * sizeof(person_t);
+    for(current = 0; current <= NUM_SNAPSHOT_ARRAYS - 1; current++)
+    {
+        long first = sizes[current] * rank / threads;
+        long last = sizes[current] * (rank + 1) / threads;
+
+        if(fields[current] != NULL && last > first)
+        {
+            memcpy(global->checkpoint->buffer + header->offsets[current]
+                + first, (char*)*fields[current] + first, last - first);
+        }
+    }
+
+    #ifdef _OPENMP
+    #pragma omp single nowait
+    #endif
+    {
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_VERSION;
+    #ifdef COMPACT_LAYOUT
+    header->compact_layout = 1;
+    #else
+    header->compact_layout = 0;
+    #endif
+    header->id_size = sizeof(person_t);
+    header->const_size = sizeof(struct const_t);
+    header->stats_size = sizeof(struct stats_t);
+    header->current_day = day + 1;
+    header->number_of_people = global->number_of_people;
+    header->num_initially_infected = global->num_initially_infected;
+    header->num_infected = global->num_infected;
+    header->num_susceptible = global->num_susceptible;
+    header->num_immune = global->num_immune;
+    header->num_dead = global->num_dead;
+    header->num_tile_checks = global->num_tile_checks;
+    header->num_tile_skips = global->num_tile_skips;
+    header->constant = *constant;
+    header->stats = *stats;
+    }
+
+    // the copy is complete once every thread is here
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+}
+
+/*
+    checkpoint_writer()
+        The writer thread writes every buffer it is handed until it is
+        stopped
+*/
+void *checkpoint_writer(void *argument)
+{
+    struct checkpoint_t *checkpoint = (struct checkpoint_t*)argument;
+
+    pthread_mutex_lock(&checkpoint->lock);
+    while(1)
+    {
+        while(!checkpoint->pending && !checkpoint->stop)
+        {
+            pthread_cond_wait(&checkpoint->changed, &checkpoint->lock);
+        }
+        if(!checkpoint->pending)
+        {
+            break;
+        }
+        pthread_mutex_unlock(&checkpoint->lock);
+
+        double start_write = omp_get_wtime();
+        int written = write_snapshot(checkpoint->file_name,
+            checkpoint->buffer, checkpoint->header->total_size);
+
+        pthread_mutex_lock(&checkpoint->lock);
+        checkpoint->write_time += omp_get_wtime() - start_write;
+        checkpoint->num_written += written;
+        checkpoint->pending = 0;
+        pthread_cond_broadcast(&checkpoint->changed);
+    }
+    pthread_mutex_unlock(&checkpoint->lock);
+
+    return(NULL);
+}
+
+/*
+    write_snapshot()
+        Writes the buffer to file_name.tmp and renames it to file_name.
+        Returns 1 if the snapshot was written.
+*/
+int write_snapshot(const char *file_name, char *buffer, long size)
+{
+    char temporary_name[4096];
+    long done = 0;
+    int file;
+
+    snprintf(temporary_name, sizeof(temporary_name), "%s.tmp", file_name);
+    file = open(temporary_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(file < 0)
+    {
+        fprintf(stderr, "ERROR: cannot write the snapshot to %s: %s\n",
+            temporary_name, strerror(errno));
+        return(0);
+    }
+    while(done < size)
+    {
+        long count = write(file, buffer + done, size - done);
+
+        if(count <= 0)
+        {
+            fprintf(stderr, "ERROR: cannot write the snapshot to %s: %s\n",
+                temporary_name, strerror(errno));
+            close(file);
+            return(0);
+        }
+        done += count;
+    }
+    fsync(file);
+    close(file);
+
+    if(rename(temporary_name, file_name) != 0)
+    {
+        fprintf(stderr, "ERROR: cannot rename the snapshot to %s: %s\n",
+            file_name, strerror(errno));
+        return(0);
+    }
+    return(1);
+}
+
+/*
+    checkpoint_finish()
+        Waits for the writer to finish the last snapshot and stops it
+*/
+void checkpoint_finish(struct global_t *global)
+{
+    struct checkpoint_t *checkpoint = global->checkpoint;
+
+    if(checkpoint == NULL)
+    {
+        return;
+    }
+
+    double start_finish = omp_get_wtime();
+    pthread_mutex_lock(&checkpoint->lock);
+    checkpoint->stop = 1;
+    pthread_cond_broadcast(&checkpoint->changed);
+    pthread_mutex_unlock(&checkpoint->lock);
+    pthread_join(checkpoint->writer, NULL);
+    checkpoint->copy_time += omp_get_wtime() - start_finish;
+}
+
+/*
+    checkpoint_report()
+        Prints the time the compute threads spent on snapshots, as a
+        part of the time of the days
+*/
+void checkpoint_report(struct global_t *global, double day_time)
+{
+    struct checkpoint_t *checkpoint = global->checkpoint;
+
+    if(checkpoint == NULL)
+    {
+        return;
+    }
+    printf("Checkpoint time: %lf (%.2lf%% of the days), %d snapshots of %.1lf MB written in %lf\n",
+        checkpoint->copy_time,
+        day_time > 0.0 ? 100.0 * checkpoint->copy_time / day_time : 0.0,
+        checkpoint->num_written,
+        checkpoint->header->total_size / 1048576.0, checkpoint->write_time);
+}
+
+/*
+    checkpoint_open()
+        Maps the snapshot of -R, checks that this build can read it, and
+        takes the counters, the stats and the parameters of the model
+        from it. The options of how to run (days, threads, engine
+        helpers, checkpoints) stay those of the command line.
+*/
+void checkpoint_open(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats)
+{
+    struct snapshot_header_t *header;
+    struct stat status;
+    char *map;
+    int file;
+    int compact_layout = 0;
+
+    #ifdef COMPACT_LAYOUT
+    compact_layout = 1;
+    #endif
+
+    file = open(constant->restart_file, O_RDONLY);
+    if(file < 0 || fstat(file, &status) != 0)
+    {
+        fprintf(stderr, "ERROR: cannot read the snapshot %s: %s\n",
+            constant->restart_file, strerror(errno));
+        exit(-1);
+    }
+    map = (char*)mmap(NULL, status.st_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, file, 0);
+    close(file);
+    if(map == MAP_FAILED)
+    {
+        fprintf(stderr, "ERROR: cannot map the snapshot %s: %s\n",
+            constant->restart_file, strerror(errno));
+        exit(-1);
+    }
+
+    header = (struct snapshot_header_t*)map;
+    if(status.st_size < (long)sizeof(struct snapshot_header_t)
+        || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0
+        || header->version != SNAPSHOT_VERSION
+        || header->total_size != status.st_size)
+    {
+        fprintf(stderr, "ERROR: %s is not a version %d snapshot\n",
+            constant->restart_file, SNAPSHOT_VERSION);
+        exit(-1);
+    }
+    if(header->compact_layout != compact_layout
+        || header->id_size != (int)sizeof(person_t)
+        || header->const_size != (int)sizeof(struct const_t)
+        || header->stats_size != (int)sizeof(struct stats_t))
+    {
+        fprintf(stderr, "ERROR: %s was written by a build with another layout\n",
+            constant->restart_file);
+        exit(-1);
+    }
+
+    global->snapshot_map = map;
+    global->snapshot_size = status.st_size;
+
+    global->current_day = header->current_day;
+    global->number_of_people = (person_t)header->number_of_people;
+    global->num_initially_infected =
+        (person_t)header->num_initially_infected;
+    global->num_infected = (person_t)header->num_infected;
+    global->num_susceptible = (person_t)header->num_susceptible;
+    global->num_immune = (person_t)header->num_immune;
+    global->num_dead = (person_t)header->num_dead;
+    global->num_tile_checks = header->num_tile_checks;
+    global->num_tile_skips = header->num_tile_skips;
+    *stats = header->stats;
+
+    constant->environment_width = header->constant.environment_width;
+    constant->environment_height = header->constant.environment_height;
+    constant->infection_radius = header->constant.infection_radius;
+    constant->duration_of_disease = header->constant.duration_of_disease;
+    constant->contagiousness_factor = header->constant.contagiousness_factor;
+    constant->deadliness_factor = header->constant.deadliness_factor;
+    constant->seed = header->constant.seed;
+    constant->contact_engine = header->constant.contact_engine;
+
+    fprintf(stderr, "restarting from the end of day %d of %s\n",
+        header->current_day - 1, constant->restart_file);
+}
+
+/*
+    checkpoint_map_arrays()
+        Points the arrays of the snapshot into the mapping, in place of
+        the arrays allocate_array() gave them
+*/
+void checkpoint_map_arrays(struct global_t *global, struct const_t *constant)
+{
+    struct snapshot_header_t *header =
+        (struct snapshot_header_t*)global->snapshot_map;
+    void **fields[NUM_SNAPSHOT_ARRAYS];
+    long sizes[NUM_SNAPSHOT_ARRAYS];
+    int current;
+
+    checkpoint_fields(global, constant, fields, sizes);
+    for(current = 0; current <= NUM_SNAPSHOT_ARRAYS - 1; current++)
+    {
+        if(fields[current] != NULL)
+        {
+            if(header->sizes[current] != sizes[current]
+                || header->offsets[current] + sizes[current]
+                > header->total_size)
+            {
+                fprintf(stderr, "ERROR: array %d of the snapshot does not fit this run\n",
+                    current);
+                exit(-1);
+            }
+            free(*fields[current]);
+            *fields[current] = global->snapshot_map + header->offsets[current];
+        }
+    }
+}
+
+/*
+    release_array()
+        Frees an array, unless it is in the mapped snapshot
+*/
+void release_array(struct global_t *global, void *array)
+{
+    if(global->snapshot_map != NULL && (char*)array >= global->snapshot_map
+        && (char*)array < global->snapshot_map + global->snapshot_size)
+    {
+        return;
+    }
+    free(array);
+}
+
+/*
+    checkpoint_cleanup()
+        Frees the writer's buffer and unmaps the snapshot
+*/
+void checkpoint_cleanup(struct global_t *global)
+{
+    if(global->checkpoint != NULL)
+    {
+        pthread_mutex_destroy(&global->checkpoint->lock);
+        pthread_cond_destroy(&global->checkpoint->changed);
+        free(global->checkpoint->buffer);
+        free(global->checkpoint);
+        global->checkpoint = NULL;
+    }
+    if(global->snapshot_map != NULL)
+    {
+        munmap(global->snapshot_map, global->snapshot_size);
+        global->snapshot_map = NULL;
+    }
+}
+
+#endif
@@ -11,11 +11,11 @@
 #include <unistd.h>     // for random
 #include <omp.h>       // OpenMP
 
-#include <trng/lcg64_shift.hpp>
-#include <trng/yarn2.hpp>
-#include <trng/uniform_dist.hpp>
-#include <trng/discrete_dist.hpp>
-#include <trng/uniform_int_dist.hpp>
+#include "Random.h"    // for random_int
+#include "People.h"    // for the locations and states of people
+#include "Nearby.h"    // for infected_nearby
+#include "Schedule.h"  // for the schedules of the loops
+#include "Profile.h"   // for PROFILE_START, PROFILE_STOP
 
 
 
@@ -25,6 +25,26 @@ void        susceptible(struct global_t *global,
 void        infected(struct global_t *global, struct const_t *constant,
                 struct stats_t *stats);
 void        update_days_infected(struct global_t *global, struct const_t *constant);
+void        move_team(struct global_t *global, struct const_t *constant);
+void        susceptible_team(struct global_t *global,
+                struct const_t *constant, struct stats_t *stats);
+void        infected_team(struct global_t *global, struct const_t *constant,
+                struct stats_t *stats);
+void        update_days_infected_team(struct global_t *global,
+                struct const_t *constant);
+inline int  move_step(unsigned long seed, int day, person_t person_id,
+                int environment_width, int environment_height, int *x,
+                int *y);
+void        fast_forward_check(struct global_t *global,
+                struct const_t *constant);
+int         fast_forward_defers(struct global_t *global,
+                struct const_t *constant);
+void        move_lazy(struct global_t *global, struct const_t *constant,
+                int first_day, int last_day);
+void        move_lazy_team(struct global_t *global,
+                struct const_t *constant, int first_day, int last_day);
+int         infected_nearby_grid(struct global_t *global, int x, int y,
+                int infection_radius);
 
 /*
     move()
@@ -32,87 +52,183 @@ void        update_days_infected(struct global_t *global, struct const_t *consta
         threads to move everyone randomly
 */
 void move(struct global_t *global, struct const_t *constant)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    move_team(global, constant);
+}
+
+/*
+    move_team()
+        The threads of the current team share the people and move
+        everyone randomly. Called by every thread of a parallel region.
+*/
+void move_team(struct global_t *global, struct const_t *constant)
 {
     // counter
-    int current_person_id;
+    person_t current_person_id;
 
     // movement
-    int x_move_direction;
-    int y_move_direction;
+    int x_location;
+    int y_location;
 
     // display envrionment variables
     int environment_width = constant->environment_width;
     int environment_height = constant->environment_height;
 
-    // arrays in global struct
-    char *states = global->states;
-    int *x_locations = global->x_locations;
-    int *y_locations = global->y_locations;
+    // random numbers, keyed on the first id of each person
+    unsigned long seed = constant->seed;
+    int current_day = global->current_day;
+    person_t *person_ids = global->person_ids;
 
+    // the loop takes the schedule of the phase, see Schedule.h
+    double start_busy = omp_get_wtime();
+    PROFILE_START(start_profile);
 
-    int num_threads;
-    int rank;
-    int x, y;
-
+    schedule_loop_team(global, PHASE_MOVE,
+        global->schedules[PHASE_MOVE].chunk_size);
     #ifdef _OPENMP
-    #pragma omp parallel private(current_person_id, num_threads, rank,x ,y)
+    #pragma omp for schedule(runtime) nowait
     #endif
+    for(current_person_id = 0; current_person_id
+        <= global->number_of_people - 1; current_person_id++)
     {
-    trng::yarn2 streamx, streamy;
-
+        // If the person is not dead, then
+        if(person_state(global, current_person_id) != DEAD)
+        {
+            x_location = person_x(global, current_person_id);
+            y_location = person_y(global, current_person_id);
 
-    num_threads = omp_get_num_threads();
-    rank = omp_get_thread_num();
+            if(move_step(seed, current_day, person_ids[current_person_id],
+                environment_width, environment_height, &x_location,
+                &y_location))
+            {
+                // The thread moves the person
+                set_person_location(global, current_person_id,
+                    x_location, y_location);
+            }
+        }
+    }
+    PROFILE_STOP(global, PROFILE_MOVE, current_day, start_profile);
+    schedule_done_team(global, constant, PHASE_MOVE, start_busy);
+}
 
-    streamx.split(2,0);
-    streamy.split(2,1);
+/*
+    move_step()
+        Moves a person from x, y by one day's random step, unless the
+        step leaves the environment. Returns 1 if the person moved.
+*/
+inline int move_step(unsigned long seed, int day, person_t person_id,
+    int environment_width, int environment_height, int *x, int *y)
+{
+    // The person randomly moves left or right or not at all in the x
+    // dimension, and up or down or not at all in the y dimension
+    int new_x_location = *x + random_int(seed, day, person_id,
+        RANDOM_X_MOVE, 3) - 1;
+    int new_y_location = *y + random_int(seed, day, person_id,
+        RANDOM_Y_MOVE, 3) - 1;
+
+    // If the person will remain in the bounds of the environment after
+    // moving, then
+    if((new_x_location >= 0) && (new_x_location < environment_width)
+        && (new_y_location >= 0) && (new_y_location < environment_height))
+    {
+        *x = new_x_location;
+        *y = new_y_location;
+        return(1);
+    }
+    return(0);
+}
 
-    streamx.split(num_threads, rank);
-    streamy.split(num_threads, rank);
+/*
+    fast_forward_check()
+        With -F, notes the first day that starts with nobody infected.
+        Nobody can be infected, recover or die from then on, so the
+        infection phases of the rest of the run have nothing to do.
+        Called by one thread at the start of the day.
+*/
+void fast_forward_check(struct global_t *global, struct const_t *constant)
+{
+    if(constant->fast_forward != FAST_FORWARD_OFF
+        && global->burned_out_day < 0 && global->num_infected == 0)
+    {
+        global->burned_out_day = global->current_day;
+    }
+}
 
+/*
+    fast_forward_defers()
+        Returns 1 if the moves of the days without infected can wait,
+        because nothing looks at where the people are before the end
+*/
+int fast_forward_defers(struct global_t *global, struct const_t *constant)
+{
+    #if defined(X_DISPLAY) || defined(TEXT_DISPLAY)
+    return(0);
+    #else
+    return(constant->fast_forward != FAST_FORWARD_OFF
+        && global->render == NULL && global->archive == NULL
+        && global->checkpoint == NULL);
+    #endif
+}
 
-    trng::uniform_int_dist distx(0, 3);
-    trng::uniform_int_dist disty(0, 3);
+/*
+    move_lazy()
+        Each process spawns threads to make the moves of the days from
+        first_day to last_day at once
+*/
+void move_lazy(struct global_t *global, struct const_t *constant,
+    int first_day, int last_day)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    move_lazy_team(global, constant, first_day, last_day);
+}
 
+/*
+    move_lazy_team()
+        The threads of the current team share the people and make the
+        moves of the days from first_day to last_day, one person at a
+        time with their location in registers. Nobody's state changes
+        in these days, so every person ends where move_team() would
+        have put them.
+*/
+void move_lazy_team(struct global_t *global, struct const_t *constant,
+    int first_day, int last_day)
+{
+    person_t current_person_id;
+    int current_day;
+    int environment_width = constant->environment_width;
+    int environment_height = constant->environment_height;
+    unsigned long seed = constant->seed;
+    person_t *person_ids = global->person_ids;
 
     #ifdef _OPENMP
-    #pragma omp for private(current_person_id, x_move_direction, \
-        y_move_direction)
+    #pragma omp for
     #endif
     for(current_person_id = 0; current_person_id
         <= global->number_of_people - 1; current_person_id++)
     {
-        // If the person is not dead, then
-        if(states[current_person_id] != DEAD)
+        if(person_state(global, current_person_id) != DEAD)
         {
-            // The thread randomly picks whether the person moves left
-            // or right or does not move in the x dimension
-            x_move_direction = distx(streamx) - 1;
-
-            // The thread randomly picks whether the person moves up
-            // or down or does not move in the y dimension
-            y_move_direction = disty(streamy) - 1;
-
-            // If the person will remain in the bounds of the
-            // environment after moving, then
-            if((x_locations[current_person_id] + x_move_direction >= 0)
-                && (x_locations[current_person_id]
-                    + x_move_direction < environment_width)
-                && (y_locations[current_person_id]
-                    + y_move_direction >= 0)
-                && (y_locations[current_person_id]
-                    + y_move_direction < environment_height))
+            int x_location = person_x(global, current_person_id);
+            int y_location = person_y(global, current_person_id);
+            person_t person_id = person_ids[current_person_id];
+
+            for(current_day = first_day; current_day <= last_day;
+                current_day++)
             {
-                // The thread moves the person
-                x_locations[current_person_id]
-                += x_move_direction;
-                y_locations[current_person_id]
-                += y_move_direction;
+                move_step(seed, current_day, person_id, environment_width,
+                    environment_height, &x_location, &y_location);
             }
+            set_person_location(global, current_person_id, x_location,
+                y_location);
         }
     }
- }
 }
+
 /*
     susceptible()
         For each of the process’s people, each process spawns threads
@@ -121,89 +237,131 @@ void move(struct global_t *global, struct const_t *constant)
 */
 void susceptible(struct global_t *global, struct const_t *constant,
     struct stats_t *stats)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    susceptible_team(global, constant, stats);
+}
+
+/*
+    susceptible_team()
+        The threads of the current team share the people and handle
+        those that are susceptible by deciding whether or not they
+        should be marked infected. Called by every thread of a
+        parallel region.
+*/
+void susceptible_team(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats)
 {
     // disease
     int infection_radius = constant->infection_radius;
     int contagiousness_factor = constant->contagiousness_factor;
 
     // counters
-    int current_person_id;
+    person_t current_person_id;
+    person_t current_slice;
     int num_infected_nearby;
-    int my_person;
 
     // pointers to arrays in global struct
-    char *states = global->states;
-    int *x_locations = global->x_locations;
-    int *y_locations = global->y_locations;
-    int *infected_x_locations = global->infected_x_locations;
-    int *infected_y_locations = global->infected_y_locations;
-
-    // OMP does not support reduction to struct, create local instance
-    // and then put local instance back to struct
-    int num_infection_attempts_local = stats->num_infection_attempts;
-    int num_infections_local = stats->num_infections;
-    int num_infected_local = global->num_infected;
-    int num_susceptible_local = global->num_susceptible;
-
-    int num_threads;
-    int rank;
-    int x, y;
-
-    #ifdef _OPENMP
-    #pragma omp parallel private(current_person_id, num_threads, rank,x ,y)
-    #endif
-    {
-    trng::yarn2 stream;
-
-    num_threads = omp_get_num_threads();
-    rank = omp_get_thread_num();
-
-    stream.split(num_threads, rank);
-
+    coord_t *infected_x_locations = global->infected_x_locations;
+    coord_t *infected_y_locations = global->infected_y_locations;
+    int *infection_raster = global->infection_raster;
+    person_t *staged_ids = global->staged_ids;
+    int environment_width = constant->environment_width;
 
-    trng::uniform_int_dist dist(0, 100);
+    // The length of the active infected list, read before any thread
+    // updates the counter, and the number of infected locations found
+    // today
+    person_t num_infected_today = global->num_infected;
+    person_t num_infected_found = global->num_infected_found;
+
+    // OMP does not support reduction to struct (nor reductions in a
+    // loop outside of its parallel region), each thread counts its
+    // own changes and adds them to the structs at the end
+    person_t num_infection_attempts_local = 0;
+    person_t num_infections_local = 0;
+    person_t num_infected_local = 0;
+    person_t num_susceptible_local = 0;
+    long num_tile_checks_local = 0;
+    long num_tile_skips_local = 0;
+
+    // random numbers, keyed on the first id of each person
+    unsigned long seed = constant->seed;
+    int current_day = global->current_day;
+    person_t *person_ids = global->person_ids;
 
     int curr_x_location;
     int curr_y_location;
-    int curr_infected_x_loc;
-    int curr_infected_y_loc;
 
+    // The threads take slices of people as the schedule of the phase
+    // hands them out (see Schedule.h); each slice stages the people it
+    // infects in its own part of staged_ids
+    person_t number_of_people = global->number_of_people;
+    person_t slice_size = schedule_slice_size(global, PHASE_SUSCEPTIBLE);
+    person_t num_slices = (number_of_people + slice_size - 1) / slice_size;
+    person_t *slice_counts = global->slice_counts;
+    double start_busy = omp_get_wtime();
+
+    // Once nobody is infected nobody can be infected
+    if(global->burned_out_day >= 0)
+    {
+        return;
+    }
+    PROFILE_START(start_profile);
+
+    schedule_loop_team(global, PHASE_SUSCEPTIBLE, 1);
     #ifdef _OPENMP
-    #pragma omp for private(current_person_id,curr_x_location, curr_y_location, curr_infected_x_loc, curr_infected_y_loc, \
-        my_person) reduction(+:num_infection_attempts_local) \
-        reduction(+:num_infected_local) reduction(+:num_susceptible_local) \
-        reduction(+:num_infections_local) reduction(+:num_infected_nearby)
+    #pragma omp for schedule(runtime) nowait
     #endif
-    for(current_person_id = 0; current_person_id
-        <= global->number_of_people - 1; current_person_id++)
+    for(current_slice = 0; current_slice <= num_slices - 1; current_slice++)
+    {
+    person_t first = current_slice * slice_size;
+    person_t last = first + slice_size < number_of_people ?
+        first + slice_size : number_of_people;
+    person_t num_staged = 0;
+
+    for(current_person_id = first; current_person_id <= last - 1;
+        current_person_id++)
     {
         // If the person is susceptible, then
-        if(states[current_person_id] == SUSCEPTIBLE)
+        if(person_state(global, current_person_id) == SUSCEPTIBLE)
         {
-            // For each of the infected people (received earlier
-            // from all processes) or until the number of infected
-            // people nearby is 1, the thread does the following
             num_infected_nearby = 0;
-            curr_x_location = x_locations[current_person_id];
-            curr_y_location = y_locations[current_person_id];
-            for(my_person = 0; my_person <= global->num_infected - 1
-                && num_infected_nearby < 1; my_person++)
+            curr_x_location = person_x(global, current_person_id);
+            curr_y_location = person_y(global, current_person_id);
+            if(global->tile_bitmap != NULL)
+            {
+                num_tile_checks_local++;
+            }
+            if(global->tile_bitmap != NULL && !tile_marked(global, constant,
+                curr_x_location, curr_y_location))
+            {
+                // No infected person is near the person's tile
+                num_tile_skips_local++;
+            }
+            else if(constant->contact_engine == ENGINE_GRID)
             {
-                // If person 1 is within the infection radius, then
-                curr_infected_x_loc =infected_x_locations[my_person];
-                curr_infected_y_loc =infected_y_locations[my_person];
-                if((curr_x_location
-                    > curr_infected_x_loc - infection_radius)
-                    && (curr_x_location
-                        < curr_infected_x_loc + infection_radius)
-                    && (curr_y_location
-                        > curr_infected_y_loc - infection_radius)
-                    && (curr_y_location
-                        < curr_infected_y_loc + infection_radius))
-                {
-                    // The thread increments the number of infected people nearby
-                    num_infected_nearby++;
-                }
+                // Only the infected people in the cells around the
+                // person can be close enough
+                num_infected_nearby = infected_nearby_grid(global,
+                    curr_x_location, curr_y_location, infection_radius);
+            }
+            else if(constant->contact_engine == ENGINE_RASTER
+                || constant->contact_engine == ENGINE_FIELD)
+            {
+                // The raster already holds how many infected people
+                // are close enough to the location
+                num_infected_nearby = infection_raster[(long)curr_y_location
+                    * environment_width + curr_x_location];
+            }
+            else
+            {
+                // The thread tests all of the infected people (received
+                // earlier from all processes) until one is nearby
+                num_infected_nearby = infected_nearby(infected_x_locations,
+                    infected_y_locations, num_infected_found,
+                    curr_x_location, curr_y_location, infection_radius);
             }
 
             #ifdef SHOW_RESULTS
@@ -214,13 +372,17 @@ void susceptible(struct global_t *global, struct const_t *constant,
             // If there is at least one infected person nearby, and
             // a random number less than 100 is less than or equal
             // to the contagiousness factor, then
-            if(num_infected_nearby >= 1 && (dist(stream))
+            if(num_infected_nearby >= 1 && random_int(seed, current_day,
+                person_ids[current_person_id], RANDOM_INFECTION, 100)
                 <= contagiousness_factor)
             {
                 // The thread changes person1’s state to infected
-                states[current_person_id] = INFECTED;
+                set_person_state(global, current_person_id, INFECTED);
 
-                // The thread updates the counters
+                // The thread stages the person for the active
+                // infected list and updates the counters
+                staged_ids[first + num_staged] = current_person_id;
+                num_staged++;
                 num_infected_local++;
                 num_susceptible_local--;
 
@@ -230,13 +392,94 @@ void susceptible(struct global_t *global, struct const_t *constant,
             }
         }
     }
-   }
+    slice_counts[current_slice] = num_staged;
+    }
+    PROFILE_STOP(global, PROFILE_SUSCEPTIBLE, current_day, start_profile);
+    schedule_done_team(global, constant, PHASE_SUSCEPTIBLE, start_busy);
+
+    // Append the newly infected people to the active infected list
+    gather_slices_team(staged_ids, slice_size, num_slices, slice_counts,
+        global->infected_ids + num_infected_today, global->thread_totals);
+
     // update struct data with local instances
-    stats->num_infection_attempts = num_infection_attempts_local;
-    stats->num_infections = num_infections_local;
-    global->num_infected = num_infected_local;
-    global->num_susceptible = num_susceptible_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    stats->num_infection_attempts += num_infection_attempts_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    stats->num_infections += num_infections_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    global->num_infected += num_infected_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    global->num_susceptible += num_susceptible_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    global->num_tile_checks += num_tile_checks_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    global->num_tile_skips += num_tile_skips_local;
+
+    // the counters are complete once every thread is here
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+}
+
+/*
+    infected_nearby_grid()
+        Returns 1 if one of the infected people bucketed by
+        find_infected_grid() is within the infection radius of the
+        location, 0 otherwise. Uses the same test as the brute force
+        loop in susceptible() on the 3x3 cells around the location.
+*/
+int infected_nearby_grid(struct global_t *global, int x, int y,
+    int infection_radius)
+{
+    // counters
+    int current_cell_y;
 
+    int cell_size = global->grid_cell_size;
+    int cell_x = x / cell_size;
+    int cell_y = y / cell_size;
+
+    // pointers to arrays in global struct
+    coord_t *infected_x_locations = global->infected_x_locations;
+    coord_t *infected_y_locations = global->infected_y_locations;
+    person_t *cell_start = global->cell_start;
+
+    // neighbouring cells, clipped to the grid
+    int first_cell_x = cell_x > 0 ? cell_x - 1 : 0;
+    int last_cell_x = cell_x < global->grid_width - 1 ?
+        cell_x + 1 : global->grid_width - 1;
+    int first_cell_y = cell_y > 0 ? cell_y - 1 : 0;
+    int last_cell_y = cell_y < global->grid_height - 1 ?
+        cell_y + 1 : global->grid_height - 1;
+
+    for(current_cell_y = first_cell_y; current_cell_y <= last_cell_y;
+        current_cell_y++)
+    {
+        // the cells of a row are next to each other, so the people
+        // of the 3 cells are one range
+        long row = (long)current_cell_y * global->grid_width;
+        person_t first = cell_start[row + first_cell_x];
+        person_t last = cell_start[row + last_cell_x + 1];
+
+        if(infected_nearby(infected_x_locations + first,
+            infected_y_locations + first, last - first, x, y,
+            infection_radius))
+        {
+            return 1;
+        }
+    }
+    return 0;
 }
 
 /*
@@ -247,71 +490,82 @@ void susceptible(struct global_t *global, struct const_t *constant,
 */
 void infected(struct global_t *global, struct const_t *constant,
     struct stats_t *stats)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    infected_team(global, constant, stats);
+}
+
+/*
+    infected_team()
+        The threads of the current team share the active infected list
+        and decide whether the people on it who have been infected for
+        the duration of the disease should be marked immune or dead.
+        Called by every thread of a parallel region.
+*/
+void infected_team(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats)
 {
     // disease
     int duration_of_disease = constant->duration_of_disease;
     int deadliness_factor = constant->deadliness_factor;
 
-    // counter
-    int current_person_id;
+    // counters
+    person_t current_infected;
+    person_t current_person_id;
+    person_t num_kept_local = 0;
+    person_t first;
+    person_t last;
 
     // pointers to arrays in global struct
-    char *states = global->states;
-    int *x_locations = global->x_locations;
-    int *y_locations =global->y_locations;
-    int *num_days_infected = global->num_days_infected;
-
-    // OMP does not support reduction to struct, create local instance
-    // and then put local instance back to struct
-    int num_recovery_attempts_local = stats->num_recovery_attempts;
-    int num_deaths_local = stats->num_deaths;
-    int num_dead_local = global->num_dead;
-    int num_infected_local = global->num_infected;
-    int num_immune_local = global->num_immune;
-
-    int num_threads;
-    int rank;
-    int x, y;
-
-    #ifdef _OPENMP
-    #pragma omp parallel private(current_person_id, num_threads, rank,x ,y)
-    #endif
+    days_t *num_days_infected = global->num_days_infected;
+    person_t *infected_ids = global->infected_ids;
+    person_t *staged_ids = global->staged_ids;
+
+    // The length of the active infected list, read before any thread
+    // updates the counter
+    person_t num_infected_today = global->num_infected;
+
+    // OMP does not support reduction to struct (nor reductions in a
+    // loop outside of its parallel region), each thread counts its
+    // own changes and adds them to the structs at the end
+    person_t num_recovery_attempts_local = 0;
+    person_t num_deaths_local = 0;
+    person_t num_dead_local = 0;
+    person_t num_infected_local = 0;
+    person_t num_immune_local = 0;
+
+    // random numbers, keyed on the first id of each person
+    unsigned long seed = constant->seed;
+    int current_day = global->current_day;
+    person_t *person_ids = global->person_ids;
+
+    PROFILE_START(start_profile);
+
+    // Each thread takes its own block of the active infected list, so
+    // it can stage the people who stay infected in its own part of
+    // staged_ids
+    thread_block(num_infected_today, &first, &last);
+    for(current_infected = first; current_infected <= last - 1;
+        current_infected++)
     {
-    trng::yarn2 stream;
-
-    num_threads = omp_get_num_threads();
-    rank = omp_get_thread_num();
-
-    stream.split(num_threads, rank);
-
+        current_person_id = infected_ids[current_infected];
 
-    trng::uniform_int_dist dist(0, 100);
-
-    #ifdef _OPENMP
-    #pragma omp  for private(current_person_id) \
-        reduction(+:num_recovery_attempts_local) reduction(+:num_dead_local) \
-        reduction(+:num_infected_local) reduction(+:num_deaths_local) \
-        reduction(+:num_immune_local)
-    #endif
-
-    for(current_person_id = 0; current_person_id
-        <= global->number_of_people - 1; current_person_id++)
-    {
-        // If the person is infected and has been for the full
-        // duration of the disease, then
-        if(states[current_person_id] == INFECTED
-            && num_days_infected[current_person_id]
-            == duration_of_disease)
+        // If the person has been infected for the full duration of
+        // the disease, then
+        if(num_days_infected[current_person_id] == duration_of_disease)
         {
             #ifdef SHOW_RESULTS
             num_recovery_attempts_local++;
             #endif
             // If a random number less than 100 is less than
             // the deadliness factor, then
-            if((dist(stream)) < deadliness_factor)
+            if(random_int(seed, current_day, person_ids[current_person_id],
+                RANDOM_DEATH, 100) < deadliness_factor)
             {
                 // The thread changes the person’s state to dead
-                states[current_person_id] = DEAD;
+                set_person_state(global, current_person_id, DEAD);
                 // The thread updates the counters
                 num_dead_local++;
                 num_infected_local--;
@@ -324,20 +578,59 @@ void infected(struct global_t *global, struct const_t *constant,
             else
             {
                 // The thread changes the person’s state to immune
-                states[current_person_id] = IMMUNE;
+                set_person_state(global, current_person_id, IMMUNE);
                 // The thread updates the counters
                 num_immune_local++;
                 num_infected_local--;
             }
+
+            // The person no longer counts in the infection field
+            if(constant->contact_engine == ENGINE_FIELD)
+            {
+                change_footprint(global, constant, current_person_id,
+                    -1, -1);
+            }
+        }
+        // Otherwise the person stays on the active infected list
+        else
+        {
+            staged_ids[first + num_kept_local] = current_person_id;
+            num_kept_local++;
         }
     }
-  }
+
+    PROFILE_STOP(global, PROFILE_INFECTED, current_day, start_profile);
+
+    // Keep only the people who are still infected on the list
+    gather_blocks_team(staged_ids, first, num_kept_local, infected_ids,
+        global->thread_totals);
+
     // update struct data with local instances
-    stats->num_recovery_attempts = num_recovery_attempts_local;
-    stats->num_deaths = num_deaths_local;
-    global->num_dead = num_dead_local;
-    global->num_infected = num_infected_local;
-    global->num_immune = num_immune_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    stats->num_recovery_attempts += num_recovery_attempts_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    stats->num_deaths += num_deaths_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    global->num_dead += num_dead_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    global->num_infected += num_infected_local;
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    global->num_immune += num_immune_local;
+
+    // the counters are complete once every thread is here
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
 }
 
 /*
@@ -347,26 +640,48 @@ void infected(struct global_t *global, struct const_t *constant,
         the number of days infected.
 */
 void update_days_infected(struct global_t *global, struct const_t *constant)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    update_days_infected_team(global, constant);
+}
+
+/*
+    update_days_infected_team()
+        The threads of the current team share the active infected
+        list and increase the number of days infected of everyone on
+        it. Called by every thread of a parallel region.
+*/
+void update_days_infected_team(struct global_t *global,
+    struct const_t *constant)
 {
     // counter
-    int current_person_id;
+    person_t current_infected;
+
+    person_t num_infected = global->num_infected;
 
     // pointers in our struct
-    char *states = global->states;
-    int *num_days_infected = global->num_days_infected;
+    person_t *infected_ids = global->infected_ids;
+    days_t *num_days_infected = global->num_days_infected;
+
+    PROFILE_START(start_profile);
 
     #ifdef _OPENMP
-        #pragma omp parallel for private(current_person_id)
+    #pragma omp for nowait
     #endif
-    for(current_person_id = 0; current_person_id
-        <= global->number_of_people - 1; current_person_id++)
+    for(current_infected = 0; current_infected <= num_infected - 1;
+        current_infected++)
     {
-        // If the person is infected, then
-        if(states[current_person_id] == INFECTED)
-        {
-            // Increment the number of days the person has been infected
-            num_days_infected[current_person_id]++;
-        }
+        // Increment the number of days the person has been infected
+        num_days_infected[infected_ids[current_infected]]++;
     }
+    PROFILE_STOP(global, PROFILE_UPDATE_DAYS, global->current_day,
+        start_profile);
+
+    // every person is updated once every thread is here
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
 }
-#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,150 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_COUNTERS_H
+#define PANDEMIC_COUNTERS_H
+
+#include <stdio.h>      // for fprintf
+#include <string.h>     // for memset, strerror
+#include <errno.h>      // for errno
+#include <unistd.h>     // for read, syscall
+#include <sys/syscall.h>    // for SYS_perf_event_open
+#include <linux/perf_event.h>   // for perf_event_attr
+
+/* Hardware counters of the profile, compiled in with -DPERF_COUNTERS
+ * (which turns on PROFILE). Every thread opens its own counters with
+ * perf_event_open the first time it starts a phase clock, counting the
+ * thread's own user-space events on whichever cpu it runs, and the
+ * profile adds the counts of the phase to the thread's slot of the day
+ * next to the time. A counter the kernel refuses (perf_event_paranoid,
+ * a container without the syscall, a virtual cpu without a PMU) reads
+ * 0 and is reported as unavailable; the run goes on without it. */
+
+// Counters of the profile
+const int COUNTER_CYCLES = 0;
+const int COUNTER_INSTRUCTIONS = 1;
+const int COUNTER_LLC_MISSES = 2;
+const int COUNTER_BRANCH_MISSES = 3;
+const int NUM_COUNTERS = 4;
+
+// Whether each counter opened: 0 not tried yet, 1 open, -1 refused,
+// with the error of the first refusal
+int counter_status[NUM_COUNTERS] = {0, 0, 0, 0};
+int counter_error = 0;
+
+// The calling thread's counters, -2 until the thread opens them
+__thread int counter_fds[NUM_COUNTERS] = {-2, -2, -2, -2};
+
+const char  *counter_name(int counter);
+void        counters_open(void);
+void        counters_read(double *counts);
+int         counters_any(void);
+
+/*
+    counter_name()
+        Returns the name of the counter
+*/
+const char *counter_name(int counter)
+{
+    const char *names[] = {"cycles", "instructions", "llc_misses",
+        "branch_misses"};
+
+    return(names[counter]);
+}
+
+/*
+    counters_open()
+        Opens the calling thread's counters. LLC misses are the generic
+        cache misses event, which the kernel maps to the last level
+        cache.
+*/
+void counters_open(void)
+{
+    const unsigned long configs[] = {PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES};
+    struct perf_event_attr attr;
+    int counter;
+
+    for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+    {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[counter];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // this thread, any cpu
+        counter_fds[counter] = syscall(SYS_perf_event_open, &attr, 0, -1,
+            -1, 0);
+        if(counter_fds[counter] >= 0)
+        {
+            __atomic_store_n(&counter_status[counter], 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            int expected = 0;
+
+            if(__atomic_compare_exchange_n(&counter_status[counter],
+                &expected, -1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                counter_error = errno;
+            }
+        }
+    }
+}
+
+/*
+    counters_read()
+        Reads the calling thread's counters into counts, opening them
+        on the first call. Counts are scaled up when the kernel had to
+        share the hardware between more counters than it has, and are
+        0 for counters that did not open.
+*/
+void counters_read(double *counts)
+{
+    unsigned long values[3];
+    int counter;
+
+    if(counter_fds[0] == -2)
+    {
+        counters_open();
+    }
+    for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+    {
+        counts[counter] = 0.0;
+        if(counter_fds[counter] >= 0 && read(counter_fds[counter], values,
+            sizeof(values)) == sizeof(values) && values[2] > 0)
+        {
+            // value, time enabled, time running
+            counts[counter] = (double)values[0] * values[1] / values[2];
+        }
+    }
+}
+
+/*
+    counters_any()
+        Returns 1 if some thread opened a counter
+*/
+int counters_any(void)
+{
+    int counter;
+
+    for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+    {
+        if(counter_status[counter] == 1)
+        {
+            return(1);
+        }
+    }
+    return(0);
+}
+
+#endif
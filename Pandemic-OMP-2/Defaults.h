@@ -8,6 +8,11 @@
 #ifndef PANDEMIC_DEFAULTS_H
 #define PANDEMIC_DEFAULTS_H
 
+// The hardware counters are part of the profile, see Counters.h
+#if defined(PERF_COUNTERS) && !defined(PROFILE)
+#define PROFILE
+#endif
+
 // States of people -- all people are one of these 4 states
 // These are const char because they are displayed as ASCII
 // if TEXT_DISPLAY is enabled
@@ -32,6 +37,88 @@ const int DEFAULT_DAYS = 250;
 const int DEFAULT_MICROSECS = 100000;
 const int DEFAULT_SIZE = 50000;
 const int DEFAULT_INIT_INFECTED = 30;
+const unsigned long DEFAULT_SEED = 1;
+const int DEFAULT_REORDER_DAYS = 0;     // never reorder the people
+const int DEFAULT_TILE_SIZE = 0;        // no tile bitmap
+const int DEFAULT_CHECKPOINT_DAYS = 0;  // never write a snapshot
+const char * const DEFAULT_CHECKPOINT_FILE = "pandemic.snapshot";
+const int DEFAULT_RENDER_DAYS = 1;      // a frame every day with -v
+
+// Contact engines susceptible() can use to look for infected people nearby
+const int ENGINE_BRUTE = 0;     // compare against every infected person
+const int ENGINE_GRID = 1;      // only the infected in the neighbouring cells
+const int ENGINE_RASTER = 2;    // one lookup in a raster of infection pressure
+const int ENGINE_FIELD = 3;     // the raster, kept up to date from day to day
+const int DEFAULT_ENGINE = ENGINE_GRID;
+
+// Ways do_display() draws the people on the X display
+const int DRAW_RECTANGLES = 0;  // one XFillRectangles per state
+const int DRAW_IMAGE = 1;       // an image built on the client, put whole
+const int DEFAULT_DRAW = DRAW_RECTANGLES;
+
+// What -F does once nobody is infected: nothing, skip the moves of the
+// days left, or make them all at the end (Core.h)
+const int FAST_FORWARD_OFF = 0;
+const int FAST_FORWARD_SKIP = 1;
+const int FAST_FORWARD_LAZY = 2;
+
+// Schedules of the loops over the people, see Schedule.h
+const int SCHEDULE_STATIC = 0;
+const int SCHEDULE_DYNAMIC = 1;
+const int SCHEDULE_GUIDED = 2;
+const int NUM_SCHEDULE_CANDIDATES = 4;
+
+// Phases whose loops are scheduled
+const int PHASE_MOVE = 0;
+const int PHASE_SUSCEPTIBLE = 1;
+const int NUM_PHASES = 2;
+
+// Types of the coordinates and days counters, see People.h
+#ifdef COMPACT_LAYOUT
+typedef unsigned short coord_t;
+typedef unsigned char days_t;
+#else
+typedef int coord_t;
+typedef int days_t;
+#endif
+
+// Type of the counts of people and of the indices and ids of people.
+// With HUGE_POPULATION they are 64 bits, for more than 2^31 - 1 people,
+// at the cost of twice the memory for the lists of ids
+#ifdef HUGE_POPULATION
+typedef long person_t;
+#else
+typedef int person_t;
+#endif
+
+// Sort key of a person when the people are reordered, see Reorder.h
+struct reorder_key_t
+{
+    unsigned long key;
+    person_t person_id;
+};
+
+// Schedule of the loop of a phase, see Schedule.h
+struct schedule_t
+{
+    // the schedule, and the people per chunk, 0 for a block per thread
+    int kind;
+    person_t chunk_size;
+    // candidate tried today, -1 once one is chosen
+    int trial;
+    // time of the slowest thread with each candidate
+    double trial_times[NUM_SCHEDULE_CANDIDATES];
+    // chunk size fitted to the time a person takes
+    person_t fitted_chunk;
+    // infected fraction when the schedule was chosen
+    double chosen_fraction;
+    // imbalance (slowest thread over the mean) summed over the days
+    // with the static schedule and with the chosen schedule
+    double static_imbalance;
+    int static_days;
+    double chosen_imbalance;
+    int chosen_days;
+};
 
 // All the data needed globally. Holds EVERYONE's location,
 // states and other necessary counters.
@@ -40,23 +127,101 @@ struct global_t
     // current day
     int current_day;
     // people counters
-    int number_of_people;
-    int num_initially_infected;
+    person_t number_of_people;
+    person_t num_initially_infected;
     // states counters
-    int num_infected;
-    int num_susceptible;
-    int num_immune;
-    int num_dead;
-    // locations
+    person_t num_infected;
+    person_t num_susceptible;
+    person_t num_immune;
+    person_t num_dead;
+    // locations -- use the functions in People.h to read and write
+    // the locations and states, their layout depends on COMPACT_LAYOUT
+    #ifdef COMPACT_LAYOUT
+    // x in the low 16 bits, y in the high 16 bits
+    unsigned int *locations;
+    #else
     int *x_locations;
     int *y_locations;
+    #endif
+    // active infected list: the ids of the num_infected people who are
+    // infected, and room for the threads to stage changes to the list
+    person_t *infected_ids;
+    person_t *staged_ids;
+    // the number of infected locations find_infected() found
+    person_t num_infected_found;
     // infected people's locations
-    int *infected_x_locations;
-    int *infected_y_locations;
+    coord_t *infected_x_locations;
+    coord_t *infected_y_locations;
+    // uniform grid over the infected people (ENGINE_GRID), cells are
+    // infection_radius wide; the infected locations of cell c are stored
+    // from cell_start[c] to cell_start[c + 1] - 1
+    int grid_cell_size;
+    int grid_width;
+    int grid_height;
+    person_t *cell_start;
+    person_t *cell_fill;
+    // one entry per thread plus one, for the prefix sums of the threads
+    person_t *thread_totals;
+    // number of infected people within the infection radius of every
+    // location of the environment (ENGINE_RASTER and ENGINE_FIELD), row
+    // by row
+    int *infection_raster;
+    // where each person's box is stamped in the field (ENGINE_FIELD),
+    // -1 if it is not
+    int *stamped_x_locations;
+    int *stamped_y_locations;
+    // one bit per tile_size x tile_size tile of the environment, set if
+    // an infected person is within the infection radius of some of it
+    int tiles_width;
+    int tiles_height;
+    unsigned long *tile_bitmap;
+    // susceptible people looked at, and those skipped by the bitmap
+    long num_tile_checks;
+    long num_tile_skips;
     // state
+    #ifdef COMPACT_LAYOUT
+    // 2 bits per person, 4 people per byte
+    unsigned char *states;
+    #else
     char *states;
+    #endif
     // infected time
-    int *num_days_infected;
+    days_t *num_days_infected;
+    // the id each person had before the people were reordered; the
+    // random numbers of a person are keyed on it
+    person_t *person_ids;
+    // room to sort the people and move their data (Reorder.h)
+    struct reorder_key_t *reorder_keys;
+    person_t *reorder_scratch;
+    // schedules of the phases, the time each thread worked on the last
+    // phase (-A only), and how many people each slice of susceptible()
+    // infected
+    struct schedule_t schedules[NUM_PHASES];
+    double *busy_times;
+    person_t *slice_counts;
+    // writer of the snapshots (Checkpoint.h), and the snapshot the run
+    // restarted from, mapped
+    struct checkpoint_t *checkpoint;
+    char *snapshot_map;
+    long snapshot_size;
+    // ring and writer of the time series (Series.h)
+    struct series_t *series;
+    // writer of the replay archive (Archive.h)
+    struct archive_t *archive;
+    // offscreen frames and their writer (Render.h)
+    struct render_t *render;
+    // first day that started with nobody infected, -1 before
+    int burned_out_day;
+    #ifdef PROFILE
+    // time of each thread in each phase on each day (Profile.h)
+    double *profile_times;
+    int profile_threads;
+    int profile_days;
+    #ifdef PERF_COUNTERS
+    // hardware counts of each thread in each phase on each day
+    double *profile_counts;
+    #endif
+    #endif
 };
 
 // Data being used as constant
@@ -73,6 +238,39 @@ struct const_t
     // time
     int total_number_of_days;
     int microseconds_per_day;
+    // contact engine used by susceptible()
+    int contact_engine;
+    // keep one team of threads for the whole run instead of one per phase
+    int persistent_team;
+    // key of all the random numbers of the run
+    unsigned long seed;
+    // reorder the people along a space-filling curve every this many
+    // days, 0 to keep them in their first order
+    int reorder_days;
+    // pin the threads and first touch the arrays in their blocks
+    int numa_aware;
+    // size of the tiles of the tile bitmap, 0 for no bitmap
+    int tile_size;
+    // time the phases and adapt the schedules of their loops
+    int adaptive_schedule;
+    // write a snapshot every this many days, 0 for none, to this file
+    int checkpoint_days;
+    const char *checkpoint_file;
+    // snapshot to restart from, NULL to start from day 0
+    const char *restart_file;
+    // file of the time series, NULL for none
+    const char *series_file;
+    // file of the replay archive, NULL for none
+    const char *archive_file;
+    // file of the offscreen frames, NULL for none, and the days between
+    // two frames
+    const char *render_file;
+    int render_days;
+    // how the X display draws the people
+    int x_draw;
+    // skip the infection phases once nobody is infected, and the moves
+    // or not
+    int fast_forward;
 };
 
 // Data being used for SHOW_RESULTS
@@ -108,6 +306,19 @@ struct display_t
     char            *green;
     char            *black;
     char            *white;
+    // the people grouped by state for XFillRectangles, or the frame
+    // built on the client for XPutImage, shared with the server when
+    // MIT-SHM is used
+    XRectangle      *rectangles;
+    XImage          *image;
+    int             shared_image;
+    #ifdef X_SHM
+    XShmSegmentInfo shm_info;
+    #endif
+    // time of the frames
+    double          frame_time;
+    double          max_frame_time;
+    int             num_frames;
     #endif
 };
 
@@ -12,20 +12,61 @@
 #include <stdlib.h>     // malloc, free, and various others
 #ifdef X_DISPLAY
 #include <X11/Xlib.h>   // X display
+#include <X11/Xutil.h>  // XDestroyImage
+#ifdef X_SHM
+#include <sys/ipc.h>    // for IPC_PRIVATE
+#include <sys/shm.h>    // for shmget, shmat
+#include <X11/extensions/XShm.h>    // MIT-SHM images
 #endif
+#endif
+#include <omp.h>       // for omp_get_wtime
+
+#include "People.h"     // for the locations and states of people
+
+/* The X display draws a frame in one of two ways (-x). With rects,
+ * the default, the people are grouped by state into one array of
+ * rectangles and each state is drawn with one XFillRectangles, instead
+ * of a request per person. With image, the frame is built on the
+ * client and put in one request, through a shared memory segment when
+ * built with -DX_SHM and the server takes it (a local server). The
+ * states are drawn dead first and infected last, so the most urgent
+ * state is on top where people share a location. To try it without a
+ * screen: xvfb-run ./Pandemic-openmp -m 0 -x image */
 
-void        init_display(struct const_t *constant, 
+// Order the states are drawn in
+const int NUM_DRAW_STATES = 4;
+const char DRAW_STATES[4] = {DEAD, SUSCEPTIBLE, IMMUNE, INFECTED};
+
+void        init_display(struct global_t *global, struct const_t *constant,
                 struct display_t *dpy);
+#ifdef X_DISPLAY
+void        init_image(struct const_t *constant, struct display_t *dpy);
+int         shm_error(Display *display, XErrorEvent *event);
+unsigned long state_pixel(struct display_t *dpy, int state_index);
+int         draw_state_index(char state);
+void        draw_rectangles(struct global_t *global, struct display_t *dpy);
+void        draw_image(struct global_t *global, struct const_t *constant,
+                struct display_t *dpy);
+#endif
 void        do_display(struct global_t *global,
                 struct const_t *constant, struct display_t *dpy);
 void        close_display(struct display_t *dpy);
+#ifdef X_DISPLAY
+void        close_display_image(struct display_t *dpy);
+#endif
 void        throttle(struct const_t *constant);
 
+#ifdef X_SHM
+// Set by shm_error() if the server refused the shared segment
+int shm_failed = 0;
+#endif
+
 /*
     init_display()
         Initializes the graphics display
 */
-void init_display(struct const_t *constant, struct display_t *dpy)
+void init_display(struct global_t *global, struct const_t *constant,
+    struct display_t *dpy)
 {
 #ifdef X_DISPLAY
     /* Initialize the X Windows Environment
@@ -61,70 +102,313 @@ void init_display(struct const_t *constant, struct display_t *dpy)
     XAllocColor(dpy->display, dpy->colormap, &dpy->immune_color);
     XAllocColor(dpy->display, dpy->colormap, &dpy->susceptible_color);
     XAllocColor(dpy->display, dpy->colormap, &dpy->dead_color);
+
+    dpy->rectangles = (XRectangle*)malloc(global->number_of_people
+        * sizeof(XRectangle));
+    dpy->image = NULL;
+    dpy->shared_image = 0;
+    dpy->frame_time = 0.0;
+    dpy->max_frame_time = 0.0;
+    dpy->num_frames = 0;
+    if(constant->x_draw == DRAW_IMAGE)
+    {
+        init_image(constant, dpy);
+    }
 #endif
 }
 
+#ifdef X_DISPLAY
 /*
-    do_display()
-        If display is enabled, Rank 0 displays a graphic of the current day
+    init_image()
+        Creates the image of the frames, in a shared memory segment if
+        the server takes one. Falls back to rectangles if the screen
+        does not have 32 bits per pixel.
 */
-void do_display(struct global_t *global, struct const_t *constant, struct display_t *dpy)
+void init_image(struct const_t *constant, struct display_t *dpy)
 {
-    #ifdef X_DISPLAY
-    int current_person_id;
+    int width = constant->environment_width * PIXEL_WIDTH_PER_PERSON;
+    int height = constant->environment_height * PIXEL_HEIGHT_PER_PERSON;
+    Visual *visual = DefaultVisual(dpy->display, dpy->screen);
+    int depth = DefaultDepth(dpy->display, dpy->screen);
 
-    char *states = global->states;
-    int *x_locations = global->x_locations;
-    int *y_locations = global->y_locations;
-
-    XClearWindow(dpy->display, dpy->window);
-    for(current_person_id = 0; current_person_id 
-        <= global->number_of_people - 1; current_person_id++)
+    #ifdef X_SHM
+    if(XShmQueryExtension(dpy->display))
+    {
+        dpy->image = XShmCreateImage(dpy->display, visual, depth, ZPixmap,
+            NULL, &dpy->shm_info, width, height);
+    }
+    if(dpy->image != NULL)
     {
-        if(states[current_person_id] == INFECTED)
+        dpy->shm_info.shmid = shmget(IPC_PRIVATE,
+            (long)dpy->image->bytes_per_line * height, IPC_CREAT | 0600);
+        dpy->shm_info.shmaddr = dpy->shm_info.shmid < 0 ? (char*)-1
+            : (char*)shmat(dpy->shm_info.shmid, NULL, 0);
+        if(dpy->shm_info.shmaddr != (char*)-1)
         {
-            XSetForeground(dpy->display, dpy->gc, dpy->infected_color.pixel);
+            // a remote server refuses the segment with an error, not a
+            // return value
+            int (*handler)(Display*, XErrorEvent*) =
+                XSetErrorHandler(shm_error);
+
+            dpy->image->data = dpy->shm_info.shmaddr;
+            dpy->shm_info.readOnly = False;
+            shm_failed = 0;
+            XShmAttach(dpy->display, &dpy->shm_info);
+            XSync(dpy->display, False);
+            XSetErrorHandler(handler);
+            dpy->shared_image = !shm_failed;
         }
-        else if(states[current_person_id] == IMMUNE)
+        if(dpy->shm_info.shmid >= 0)
         {
-            XSetForeground(dpy->display, dpy->gc, dpy->immune_color.pixel);
+            // freed once both sides detach
+            shmctl(dpy->shm_info.shmid, IPC_RMID, NULL);
         }
-        else if(states[current_person_id] == SUSCEPTIBLE)
+        if(!dpy->shared_image)
         {
-            XSetForeground(dpy->display, dpy->gc, dpy->susceptible_color.pixel);
+            if(dpy->shm_info.shmaddr != (char*)-1)
+            {
+                shmdt(dpy->shm_info.shmaddr);
+            }
+            dpy->image->data = NULL;
+            XDestroyImage(dpy->image);
+            dpy->image = NULL;
         }
-        else if(states[current_person_id] == DEAD)
+    }
+    #endif
+
+    if(dpy->image == NULL)
+    {
+        dpy->image = XCreateImage(dpy->display, visual, depth, ZPixmap, 0,
+            NULL, width, height, 32, 0);
+        dpy->image->data = (char*)malloc((long)dpy->image->bytes_per_line
+            * height);
+    }
+
+    if(dpy->image->bits_per_pixel != 32)
+    {
+        fprintf(stderr, "X display: the screen does not have 32 bits per pixel, drawing rectangles\n");
+        close_display_image(dpy);
+        constant->x_draw = DRAW_RECTANGLES;
+    }
+}
+
+#ifdef X_SHM
+/*
+    shm_error()
+        Notes that the server refused the shared segment
+*/
+int shm_error(Display *display, XErrorEvent *event)
+{
+    shm_failed = 1;
+    return(0);
+}
+#endif
+
+/*
+    state_pixel()
+        Returns the pixel of the color of a state, in the order of
+        DRAW_STATES
+*/
+unsigned long state_pixel(struct display_t *dpy, int state_index)
+{
+    unsigned long pixels[4] = {dpy->dead_color.pixel,
+        dpy->susceptible_color.pixel, dpy->immune_color.pixel,
+        dpy->infected_color.pixel};
+
+    return(pixels[state_index]);
+}
+
+/*
+    draw_state_index()
+        Returns where a state is in DRAW_STATES, -1 for none
+*/
+int draw_state_index(char state)
+{
+    int state_index;
+
+    for(state_index = 0; state_index <= NUM_DRAW_STATES - 1; state_index++)
+    {
+        if(DRAW_STATES[state_index] == state)
         {
-            XSetForeground(dpy->display, dpy->gc, dpy->dead_color.pixel);
+            return(state_index);
         }
-        else
+    }
+    return(-1);
+}
+
+/*
+    draw_rectangles()
+        Sorts the people by state into the rectangles, counting them
+        first, and draws each state with one request
+*/
+void draw_rectangles(struct global_t *global, struct display_t *dpy)
+{
+    XRectangle *rectangles = dpy->rectangles;
+    int counts[4] = {0, 0, 0, 0};
+    int starts[4];
+    person_t current_person_id;
+    int state_index;
+
+    for(current_person_id = 0; current_person_id
+        <= global->number_of_people - 1; current_person_id++)
+    {
+        char current_state = person_state(global, current_person_id);
+
+        state_index = draw_state_index(current_state);
+        if(state_index < 0)
         {
-            fprintf(stderr, "ERROR: person %d has state '%c'\n",
-                current_person_id, states[current_person_id]);
+            fprintf(stderr, "ERROR: person %ld has state '%c'\n",
+                (long)global->person_ids[current_person_id], current_state);
             exit(-1);
         }
-        XFillRectangle(dpy->display, dpy->window, dpy->gc,
-            x_locations[current_person_id] 
-            * PIXEL_WIDTH_PER_PERSON, 
-            y_locations[current_person_id]
-            * PIXEL_HEIGHT_PER_PERSON, 
-            PIXEL_WIDTH_PER_PERSON, 
-            PIXEL_HEIGHT_PER_PERSON);
+        counts[state_index]++;
+    }
+    starts[0] = 0;
+    for(state_index = 1; state_index <= NUM_DRAW_STATES - 1; state_index++)
+    {
+        starts[state_index] = starts[state_index - 1]
+            + counts[state_index - 1];
+    }
+
+    for(current_person_id = 0; current_person_id
+        <= global->number_of_people - 1; current_person_id++)
+    {
+        XRectangle *rectangle = &rectangles[starts[draw_state_index(
+            person_state(global, current_person_id))]++];
+
+        rectangle->x = person_x(global, current_person_id)
+            * PIXEL_WIDTH_PER_PERSON;
+        rectangle->y = person_y(global, current_person_id)
+            * PIXEL_HEIGHT_PER_PERSON;
+        rectangle->width = PIXEL_WIDTH_PER_PERSON;
+        rectangle->height = PIXEL_HEIGHT_PER_PERSON;
+    }
+
+    // starts now holds where each state ends
+    XClearWindow(dpy->display, dpy->window);
+    for(state_index = 0; state_index <= NUM_DRAW_STATES - 1; state_index++)
+    {
+        if(counts[state_index] > 0)
+        {
+            XSetForeground(dpy->display, dpy->gc,
+                state_pixel(dpy, state_index));
+            XFillRectangles(dpy->display, dpy->window, dpy->gc,
+                rectangles + starts[state_index] - counts[state_index],
+                counts[state_index]);
+        }
+    }
+}
+
+/*
+    draw_image()
+        Builds the frame in the image, each person a block of the color
+        of their state over the white of the window, and puts it
+*/
+void draw_image(struct global_t *global, struct const_t *constant,
+    struct display_t *dpy)
+{
+    XImage *image = dpy->image;
+    unsigned long background = WhitePixel(dpy->display, dpy->screen);
+    int words_per_line = image->bytes_per_line / 4;
+    person_t current_person_id;
+    int current_row;
+    int current_column;
+
+    for(current_row = 0; current_row <= image->height - 1; current_row++)
+    {
+        unsigned int *row = (unsigned int*)image->data
+            + (long)current_row * words_per_line;
+
+        for(current_column = 0; current_column <= image->width - 1;
+            current_column++)
+        {
+            row[current_column] = background;
+        }
+    }
+
+    // the dead first and the infected last, as with rectangles
+    int state_index;
+    for(state_index = 0; state_index <= NUM_DRAW_STATES - 1; state_index++)
+    {
+        unsigned int pixel = state_pixel(dpy, state_index);
+
+        for(current_person_id = 0; current_person_id
+            <= global->number_of_people - 1; current_person_id++)
+        {
+            if(person_state(global, current_person_id)
+                != DRAW_STATES[state_index])
+            {
+                continue;
+            }
+
+            unsigned int *block = (unsigned int*)image->data
+                + (long)person_y(global, current_person_id)
+                * PIXEL_HEIGHT_PER_PERSON * words_per_line
+                + person_x(global, current_person_id)
+                * PIXEL_WIDTH_PER_PERSON;
+
+            for(current_row = 0; current_row <= PIXEL_HEIGHT_PER_PERSON - 1;
+                current_row++)
+            {
+                for(current_column = 0; current_column
+                    <= PIXEL_WIDTH_PER_PERSON - 1; current_column++)
+                {
+                    block[current_column] = pixel;
+                }
+                block += words_per_line;
+            }
+        }
+    }
+
+    #ifdef X_SHM
+    if(dpy->shared_image)
+    {
+        XShmPutImage(dpy->display, dpy->window, dpy->gc, image, 0, 0, 0, 0,
+            image->width, image->height, False);
+        // the server reads the segment, so it must be done before the
+        // next frame is drawn into it
+        XSync(dpy->display, False);
+        return;
+    }
+    #endif
+    XPutImage(dpy->display, dpy->window, dpy->gc, image, 0, 0, 0, 0,
+        image->width, image->height);
+}
+#endif
+
+/*
+    do_display()
+        If display is enabled, Rank 0 displays a graphic of the current day
+*/
+void do_display(struct global_t *global, struct const_t *constant, struct display_t *dpy)
+{
+    #ifdef X_DISPLAY
+    double start_frame = omp_get_wtime();
+
+    if(constant->x_draw == DRAW_IMAGE)
+    {
+        draw_image(global, constant, dpy);
+    }
+    else
+    {
+        draw_rectangles(global, dpy);
     }
     XFlush(dpy->display);
+
+    double frame_time = omp_get_wtime() - start_frame;
+    dpy->frame_time += frame_time;
+    dpy->max_frame_time = frame_time > dpy->max_frame_time ? frame_time
+        : dpy->max_frame_time;
+    dpy->num_frames++;
     #endif
 
     #ifdef TEXT_DISPLAY
-    int current_person_id;
+    person_t current_person_id;
     int current_location_x;
     int current_location_y;
     int environment_height = constant->environment_height;
     int environment_width = constant->environment_width;
 
-    char *states = global->states;
-    int *x_locations = global->x_locations;
-    int *y_locations = global->y_locations;
-
     for(current_location_y = 0; 
         current_location_y <= environment_height - 1;
         current_location_y++)
@@ -141,9 +425,9 @@ void do_display(struct global_t *global, struct const_t *constant, struct displa
         current_person_id <= global->number_of_people - 1;
         current_person_id++)
     {
-        dpy->environment[x_locations[current_person_id]]
-        [y_locations[current_person_id]] = 
-        states[current_person_id];
+        dpy->environment[person_x(global, current_person_id)]
+        [person_y(global, current_person_id)] = 
+        person_state(global, current_person_id);
     }
 
     printf("----------------------\n");
@@ -170,11 +454,47 @@ void do_display(struct global_t *global, struct const_t *constant, struct displa
 void close_display(struct display_t *dpy)
 {
 #ifdef X_DISPLAY
+    if(dpy->num_frames > 0)
+    {
+        printf("X display (%s): %d frames, %lf ms per frame (max %lf ms)\n",
+            dpy->image == NULL ? "rectangles" : dpy->shared_image
+            ? "shared image" : "image", dpy->num_frames,
+            1000.0 * dpy->frame_time / dpy->num_frames,
+            1000.0 * dpy->max_frame_time);
+    }
+    close_display_image(dpy);
+    free(dpy->rectangles);
     XDestroyWindow(dpy->display, dpy->window);
     XCloseDisplay(dpy->display);
 #endif
 }
 
+#ifdef X_DISPLAY
+/*
+    close_display_image()
+        Frees the image of the frames and detaches its segment
+*/
+void close_display_image(struct display_t *dpy)
+{
+    if(dpy->image == NULL)
+    {
+        return;
+    }
+    #ifdef X_SHM
+    if(dpy->shared_image)
+    {
+        XShmDetach(dpy->display, &dpy->shm_info);
+        shmdt(dpy->shm_info.shmaddr);
+        dpy->image->data = NULL;
+        dpy->shared_image = 0;
+    }
+    #endif
+    // XDestroyImage frees the data the client allocated
+    XDestroyImage(dpy->image);
+    dpy->image = NULL;
+}
+#endif
+
 /*
     throttle()
         Slows down the simulation to make X display easier to watch.
@@ -0,0 +1,573 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+/* MPI driver: the environment is split into strips of rows, one per
+ * process, and each process keeps only the people in its strip. The
+ * threads of a process share its people as in Pandemic.c.
+ *
+ * Every day each process sends its neighbours the infected people
+ * within infection_radius rows of their strips (the halo), which it
+ * keeps as ghosts at the end of its arrays while the contact engine
+ * finds the infected locations. After the day, people who walked out
+ * of the strip migrate to the neighbour whose strip they are in.
+ *
+ * The random numbers of a person are keyed on its first id, so the
+ * results do not depend on the number of processes.
+ *
+ * Usage: mpirun -np N Pandemic-mpi [Pandemic options] */
+
+#include <stdio.h>      // for printf
+#include <stdlib.h>     // for malloc, free, and various others
+#include <string.h>     // for memset
+#include <mpi.h>        // MPI
+#include <omp.h>
+
+#include "Defaults.h"
+#include "Initialize.h"
+#include "Infection.h"
+#include "Reorder.h"
+#include "Core.h"
+#include "Finalize.h"
+
+// Room for people in each process, as a multiple of an even share
+const int STRIP_CAPACITY_FACTOR = 2;
+const int STRIP_CAPACITY_EXTRA = 1024;
+
+// Message tags
+const int TAG_COUNT = 1;
+const int TAG_DATA = 2;
+
+// A person moving to another strip
+struct migrant_t
+{
+    person_t person_id;
+    int x;
+    int y;
+    int num_days_infected;
+    char state;
+};
+
+// The strip of the process and its buffers
+struct strip_t
+{
+    int rank;
+    int size;
+    // neighbour processes, MPI_PROC_NULL at the edges of the environment
+    int lower;
+    int upper;
+    // the rows of the strip are first_y to last_y - 1
+    int first_y;
+    int last_y;
+    // the people, ghosts and arrivals the arrays can hold
+    person_t capacity;
+    int num_ghosts;
+    // x and y of the infected people sent to each neighbour, and those
+    // received
+    int *halo_lower;
+    int *halo_upper;
+    int *halo_received;
+    // people leaving for each neighbour, and those arriving
+    struct migrant_t *migrants_lower;
+    struct migrant_t *migrants_upper;
+    struct migrant_t *migrants_received;
+    // seconds spent on the people and on the messages
+    double compute_time;
+    double comm_time;
+};
+
+void        set_strip(struct strip_t *strip, struct global_t *global,
+                struct const_t *constant);
+void        init_strip(struct global_t *global, struct const_t *constant,
+                struct strip_t *strip);
+int         exchange(struct strip_t *strip, void *send_lower,
+                int count_lower, void *send_upper, int count_upper,
+                void *received, int item_size, person_t room);
+void        exchange_halo(struct global_t *global, struct const_t *constant,
+                struct strip_t *strip);
+void        migrate(struct global_t *global, struct strip_t *strip);
+void        count_state(struct global_t *global, char state, int change);
+void        report(struct global_t *global, struct const_t *constant,
+                struct stats_t *stats, struct strip_t *strip,
+                double total_time);
+
+/*
+    set_strip()
+        Each process finds its rows, its neighbours and the room it
+        needs, and allocates the message buffers
+*/
+void set_strip(struct strip_t *strip, struct global_t *global,
+    struct const_t *constant)
+{
+    int height = constant->environment_height;
+    long even_share;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &strip->rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &strip->size);
+
+    strip->first_y = (long)height * strip->rank / strip->size;
+    strip->last_y = (long)height * (strip->rank + 1) / strip->size;
+    strip->lower = strip->rank > 0 ? strip->rank - 1 : MPI_PROC_NULL;
+    strip->upper = strip->rank < strip->size - 1 ?
+        strip->rank + 1 : MPI_PROC_NULL;
+
+    // The halo comes from the neighbours only, so every strip has to
+    // be at least infection_radius rows high
+    if(height / strip->size < constant->infection_radius
+        || height / strip->size < 1)
+    {
+        if(strip->rank == 0)
+        {
+            fprintf(stderr, "ERROR: %d strips of %d rows are thinner than the infection radius (%d)\n",
+                strip->size, height, constant->infection_radius);
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    even_share = (global->number_of_people + strip->size - 1) / strip->size;
+    strip->capacity = STRIP_CAPACITY_FACTOR * even_share
+        + STRIP_CAPACITY_EXTRA;
+    strip->num_ghosts = 0;
+
+    strip->halo_lower = (int*)malloc(2 * strip->capacity * sizeof(int));
+    strip->halo_upper = (int*)malloc(2 * strip->capacity * sizeof(int));
+    strip->halo_received = (int*)malloc(2 * strip->capacity * sizeof(int));
+    strip->migrants_lower = (struct migrant_t*)malloc(strip->capacity
+        * sizeof(struct migrant_t));
+    strip->migrants_upper = (struct migrant_t*)malloc(strip->capacity
+        * sizeof(struct migrant_t));
+    strip->migrants_received = (struct migrant_t*)malloc(strip->capacity
+        * sizeof(struct migrant_t));
+
+    strip->compute_time = 0.0;
+    strip->comm_time = 0.0;
+}
+
+/*
+    init_strip()
+        Each process places every person as init_array() would and
+        keeps those in its strip, then lists its infected people
+*/
+void init_strip(struct global_t *global, struct const_t *constant,
+    struct strip_t *strip)
+{
+    person_t current_person_id;
+    person_t number_of_people = global->number_of_people;
+    person_t num_people_local = 0;
+    int x;
+    int y;
+
+    #ifdef COMPACT_LAYOUT
+    memset(global->states, 0, (strip->capacity + 3) / 4);
+    #endif
+
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        y = random_int(constant->seed, 0, current_person_id,
+            RANDOM_Y_LOCATION, constant->environment_height);
+        if(y < strip->first_y || y >= strip->last_y)
+        {
+            continue;
+        }
+        if(num_people_local == strip->capacity)
+        {
+            fprintf(stderr, "ERROR: process %d has no room for more than %ld people\n",
+                strip->rank, (long)strip->capacity);
+            MPI_Abort(MPI_COMM_WORLD, -1);
+        }
+
+        x = random_int(constant->seed, 0, current_person_id,
+            RANDOM_X_LOCATION, constant->environment_width);
+        set_person_location(global, num_people_local, x, y);
+        global->person_ids[num_people_local] = current_person_id;
+        global->num_days_infected[num_people_local] = 0;
+        if(current_person_id < global->num_initially_infected)
+        {
+            set_person_state(global, num_people_local, INFECTED);
+            global->num_infected++;
+        }
+        else
+        {
+            set_person_state(global, num_people_local, SUSCEPTIBLE);
+            global->num_susceptible++;
+        }
+        num_people_local++;
+    }
+    global->number_of_people = num_people_local;
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    list_infected_team(global);
+}
+
+/*
+    exchange()
+        Each process sends count_lower items to its lower neighbour and
+        count_upper items to its upper neighbour, and receives what its
+        neighbours send it into received. Returns the number of items
+        received.
+*/
+int exchange(struct strip_t *strip, void *send_lower, int count_lower,
+    void *send_upper, int count_upper, void *received, int item_size,
+    person_t room)
+{
+    int from_lower = 0;
+    int from_upper = 0;
+
+    MPI_Sendrecv(&count_lower, 1, MPI_INT, strip->lower, TAG_COUNT,
+        &from_upper, 1, MPI_INT, strip->upper, TAG_COUNT, MPI_COMM_WORLD,
+        MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&count_upper, 1, MPI_INT, strip->upper, TAG_COUNT,
+        &from_lower, 1, MPI_INT, strip->lower, TAG_COUNT, MPI_COMM_WORLD,
+        MPI_STATUS_IGNORE);
+
+    if(from_lower + from_upper > room)
+    {
+        fprintf(stderr, "ERROR: process %d has no room for %d more people\n",
+            strip->rank, from_lower + from_upper);
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    MPI_Sendrecv(send_lower, count_lower * item_size, MPI_BYTE,
+        strip->lower, TAG_DATA, received, from_upper * item_size, MPI_BYTE,
+        strip->upper, TAG_DATA, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(send_upper, count_upper * item_size, MPI_BYTE,
+        strip->upper, TAG_DATA, (char*)received + from_upper * item_size,
+        from_lower * item_size, MPI_BYTE, strip->lower, TAG_DATA,
+        MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    return(from_lower + from_upper);
+}
+
+/*
+    exchange_halo()
+        Each process sends its neighbours its infected people within
+        infection_radius rows of their strips. People move at most one
+        row before susceptible() runs, so these are all the infected
+        people who can reach the neighbour's people. The received
+        people become ghosts after the process's people and are added
+        to the end of the active infected list.
+*/
+void exchange_halo(struct global_t *global, struct const_t *constant,
+    struct strip_t *strip)
+{
+    person_t current_infected;
+    int current_ghost;
+    int count_lower = 0;
+    int count_upper = 0;
+    person_t number_of_people = global->number_of_people;
+    int infection_radius = constant->infection_radius;
+
+    person_t *infected_ids = global->infected_ids;
+
+    for(current_infected = 0; current_infected <= global->num_infected - 1;
+        current_infected++)
+    {
+        person_t current_person_id = infected_ids[current_infected];
+        int x = person_x(global, current_person_id);
+        int y = person_y(global, current_person_id);
+
+        if(y < strip->first_y + infection_radius)
+        {
+            strip->halo_lower[2 * count_lower] = x;
+            strip->halo_lower[2 * count_lower + 1] = y;
+            count_lower++;
+        }
+        if(y >= strip->last_y - infection_radius)
+        {
+            strip->halo_upper[2 * count_upper] = x;
+            strip->halo_upper[2 * count_upper + 1] = y;
+            count_upper++;
+        }
+    }
+
+    strip->num_ghosts = exchange(strip, strip->halo_lower, count_lower,
+        strip->halo_upper, count_upper, strip->halo_received,
+        2 * sizeof(int), strip->capacity - number_of_people);
+
+    for(current_ghost = 0; current_ghost <= strip->num_ghosts - 1;
+        current_ghost++)
+    {
+        set_person_location(global, number_of_people + current_ghost,
+            strip->halo_received[2 * current_ghost],
+            strip->halo_received[2 * current_ghost + 1]);
+        infected_ids[global->num_infected + current_ghost] =
+            number_of_people + current_ghost;
+    }
+    global->num_infected += strip->num_ghosts;
+}
+
+/*
+    count_state()
+        Changes the counter of the state by change
+*/
+void count_state(struct global_t *global, char state, int change)
+{
+    if(state == INFECTED)
+    {
+        global->num_infected += change;
+    }
+    else if(state == IMMUNE)
+    {
+        global->num_immune += change;
+    }
+    else if(state == SUSCEPTIBLE)
+    {
+        global->num_susceptible += change;
+    }
+    else
+    {
+        global->num_dead += change;
+    }
+}
+
+/*
+    migrate()
+        Each process sends the people who walked out of its strip to
+        the neighbour whose strip they are in, closes the gaps they
+        leave, adds the people who walked in, and lists its infected
+        people again
+*/
+void migrate(struct global_t *global, struct strip_t *strip)
+{
+    person_t current_person_id;
+    int current_migrant;
+    int count_lower = 0;
+    int count_upper = 0;
+    int num_kept = 0;
+    int num_received;
+    struct migrant_t *migrant;
+
+    person_t *person_ids = global->person_ids;
+    days_t *num_days_infected = global->num_days_infected;
+
+    for(current_person_id = 0; current_person_id
+        <= global->number_of_people - 1; current_person_id++)
+    {
+        int x = person_x(global, current_person_id);
+        int y = person_y(global, current_person_id);
+        char state = person_state(global, current_person_id);
+
+        if(y < strip->first_y || y >= strip->last_y)
+        {
+            migrant = y < strip->first_y ?
+                &strip->migrants_lower[count_lower++] :
+                &strip->migrants_upper[count_upper++];
+            migrant->person_id = person_ids[current_person_id];
+            migrant->x = x;
+            migrant->y = y;
+            migrant->num_days_infected = num_days_infected[current_person_id];
+            migrant->state = state;
+            count_state(global, state, -1);
+            continue;
+        }
+        if(num_kept != current_person_id)
+        {
+            set_person_location(global, num_kept, x, y);
+            set_person_state(global, num_kept, state);
+            person_ids[num_kept] = person_ids[current_person_id];
+            num_days_infected[num_kept] = num_days_infected[current_person_id];
+        }
+        num_kept++;
+    }
+    global->number_of_people = num_kept;
+
+    num_received = exchange(strip, strip->migrants_lower, count_lower,
+        strip->migrants_upper, count_upper, strip->migrants_received,
+        sizeof(struct migrant_t), strip->capacity - num_kept);
+
+    for(current_migrant = 0; current_migrant <= num_received - 1;
+        current_migrant++)
+    {
+        migrant = &strip->migrants_received[current_migrant];
+        current_person_id = global->number_of_people;
+        set_person_location(global, current_person_id, migrant->x,
+            migrant->y);
+        set_person_state(global, current_person_id, migrant->state);
+        person_ids[current_person_id] = migrant->person_id;
+        num_days_infected[current_person_id] = migrant->num_days_infected;
+        count_state(global, migrant->state, 1);
+        global->number_of_people++;
+    }
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    list_infected_team(global);
+}
+
+/*
+    report()
+        Process 0 prints the counts of all the processes and how the
+        time was split between the people and the messages
+*/
+void report(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats, struct strip_t *strip, double total_time)
+{
+    // summed over the processes the counts can pass an int even when
+    // each process's people fit one
+    long counts[4] = {global->num_susceptible, global->num_infected,
+        global->num_immune, global->num_dead};
+    double local_stats[4] = {stats->num_infections,
+        stats->num_infection_attempts, stats->num_deaths,
+        stats->num_recovery_attempts};
+    double times[2] = {strip->compute_time, strip->comm_time};
+    long total_counts[4];
+    double total_stats[4];
+    double sum_times[2];
+    double max_times[2];
+
+    MPI_Reduce(counts, total_counts, 4, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(local_stats, total_stats, 4, MPI_DOUBLE, MPI_SUM, 0,
+        MPI_COMM_WORLD);
+    MPI_Reduce(times, sum_times, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if(strip->rank != 0)
+    {
+        return;
+    }
+
+    #ifdef SHOW_RESULTS
+    printf("final counts: %ld susceptible, %ld infected, %ld immune, %ld dead \nActual contagiousness: %f \nActual deadliness: %f \n",
+        total_counts[0], total_counts[1], total_counts[2], total_counts[3],
+        100.0 * (total_stats[0] / (total_stats[1] == 0 ? 1 : total_stats[1])),
+        100.0 * (total_stats[2] / (total_stats[3] == 0 ? 1 : total_stats[3])));
+    #endif
+    printf("Processes: %d, threads per process: %d\n", strip->size,
+        omp_get_max_threads());
+    printf("Compute time: %lf (max %lf)\n", sum_times[0] / strip->size,
+        max_times[0]);
+    printf("Communication time: %lf (max %lf)\n", sum_times[1] / strip->size,
+        max_times[1]);
+    printf("%lf\t", total_time);
+    printf("\n");
+}
+
+int main(int argc, char ** argv)
+{
+    /**** In Defaults.h ****/
+    struct global_t global;
+    struct const_t constant;
+    struct stats_t stats;
+    struct display_t dpy;
+    /***********************/
+
+    struct strip_t strip;
+    int provided;
+    double start_phase;
+
+    // Only the master thread of a process sends messages
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    double start_run = MPI_Wtime();
+
+    /***************** In Initialize.h *****************/
+    init_defaults(&global, &constant, &stats);
+    parse_args(&global, &constant, argc, argv);
+    init_check(&global, &constant);
+    select_nearby();
+    if(constant.numa_aware)
+    {
+        pin_threads();
+    }
+    /***************************************************/
+
+    set_strip(&strip, &global, &constant);
+
+    // The infection field is kept from day to day, but the ghosts and
+    // the people of a process change every day
+    if(constant.contact_engine == ENGINE_FIELD)
+    {
+        if(strip.rank == 0)
+        {
+            fprintf(stderr, "ERROR: the field engine does not work across processes\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    // A snapshot, an archive or a frame holds the people of one
+    // process, and the series the counts of one process
+    if(constant.checkpoint_days > 0 || constant.restart_file != NULL
+        || constant.series_file != NULL || constant.archive_file != NULL
+        || constant.render_file != NULL)
+    {
+        if(strip.rank == 0)
+        {
+            fprintf(stderr, "ERROR: snapshots, series, archives and frames do not work across processes\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    // A process with nobody infected can still catch a ghost's infection
+    if(constant.fast_forward != FAST_FORWARD_OFF)
+    {
+        if(strip.rank == 0)
+        {
+            fprintf(stderr, "ERROR: fast-forward does not work across processes\n");
+        }
+        MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+
+    // The arrays hold the process's people, its ghosts and its arrivals
+    person_t number_of_people = global.number_of_people;
+    global.number_of_people = strip.capacity;
+    allocate_array(&global, &constant, &dpy);
+    global.number_of_people = number_of_people;
+    init_strip(&global, &constant, &strip);
+
+    for(global.current_day = 0; global.current_day
+        <= constant.total_number_of_days; global.current_day++)
+    {
+        start_phase = MPI_Wtime();
+        if(reorder_day(&global, &constant))
+        {
+            reorder(&global, &constant);
+        }
+        strip.compute_time += MPI_Wtime() - start_phase;
+
+        start_phase = MPI_Wtime();
+        exchange_halo(&global, &constant, &strip);
+        strip.comm_time += MPI_Wtime() - start_phase;
+
+        /****** In Infection.h ******/
+        start_phase = MPI_Wtime();
+        find_infected_engine(&global, &constant);
+        // The engine has the ghosts, the list goes back to the
+        // process's own infected people
+        global.num_infected -= strip.num_ghosts;
+        /****************************/
+
+        /************** In Core.h *************/
+        move(&global, &constant);
+        susceptible(&global, &constant, &stats);
+        infected(&global, &constant, &stats);
+        update_days_infected(&global, &constant);
+        /**************************************/
+        strip.compute_time += MPI_Wtime() - start_phase;
+
+        start_phase = MPI_Wtime();
+        migrate(&global, &strip);
+        strip.comm_time += MPI_Wtime() - start_phase;
+    }
+
+    report(&global, &constant, &stats, &strip, MPI_Wtime() - start_run);
+
+    /******** In Finialize.h ********/
+    cleanup(&global, &constant, &dpy);
+    /********************************/
+    free(strip.halo_lower);
+    free(strip.halo_upper);
+    free(strip.halo_received);
+    free(strip.migrants_lower);
+    free(strip.migrants_upper);
+    free(strip.migrants_received);
+
+    MPI_Finalize();
+
+    exit(EXIT_SUCCESS);
+}
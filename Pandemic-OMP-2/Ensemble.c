@@ -0,0 +1,407 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+/* Ensemble driver: runs every replica of a parameter sweep in one
+ * process and writes the per-day statistics of each parameter point.
+ *
+ * Usage: Pandemic-ensemble [Pandemic options] sweep_file [output_file]
+ *
+ * The sweep file has one parameter point per line:
+ *     replicas contagiousness_factor deadliness_factor infection_radius duration_of_disease
+ * Lines starting with '#' are comments. A line "schedule replica" runs
+ * one replica per thread, "schedule team" runs the replicas one after
+ * the other with all the threads; by default small populations are run
+ * one replica per thread. */
+
+#include <stdio.h>      // for printf
+#include <stdlib.h>     // for malloc, free, and various others
+#include <string.h>     // for strcmp
+#include <math.h>       // for sqrt
+#include <unistd.h>     // for getopt's optind
+#include <limits.h>     // for INT_MAX
+#include <omp.h>
+
+#include "Defaults.h"
+#include "Initialize.h"
+#include "Infection.h"
+#include "Reorder.h"
+#include "Core.h"
+#include "Finalize.h"
+
+// How the replicas are shared by the threads
+const int SCHEDULE_AUTO = 0;
+const int SCHEDULE_REPLICA = 1;     // one replica per thread
+const int SCHEDULE_TEAM = 2;        // all threads on each replica
+
+// Below this many people a replica is too small to keep a whole team
+// busy, so by default each thread runs its own replicas
+const int ENSEMBLE_TEAM_SIZE = 200000;
+
+// Counters recorded every day: susceptible, infected, immune, dead
+const int NUM_DAY_COUNTERS = 4;
+
+// One parameter point of the sweep
+struct point_t
+{
+    int replicas;
+    int contagiousness_factor;
+    int deadliness_factor;
+    int infection_radius;
+    int duration_of_disease;
+    // for each day and counter, the sum over the replicas of the counter
+    // and of its square
+    double *sums;
+    double *squares;
+};
+
+int         read_sweep(const char *file_name, struct const_t *constant,
+                struct point_t **points, int *schedule);
+void        run_replica(struct global_t *global, struct const_t *constant,
+                struct stats_t *stats, person_t *day_counts);
+void        add_replica(struct point_t *point, person_t *day_counts,
+                int number_of_days);
+void        write_results(FILE *output, struct point_t *points,
+                int num_points, int number_of_days);
+
+/*
+    read_sweep()
+        Reads the parameter points of the sweep file, which must be
+        runs init_check() would accept with the options given. Returns
+        the number of points.
+*/
+int read_sweep(const char *file_name, struct const_t *constant,
+    struct point_t **points, int *schedule)
+{
+    FILE *file = fopen(file_name, "r");
+    char line[256];
+    char word[32];
+    int num_points = 0;
+    int capacity = 16;
+    int longest_duration = INT_MAX;
+
+    #ifdef COMPACT_LAYOUT
+    longest_duration = COMPACT_MAX_DURATION;
+    #endif
+
+    if(file == NULL)
+    {
+        fprintf(stderr, "ERROR: could not open sweep file %s\n", file_name);
+        exit(-1);
+    }
+
+    *points = (struct point_t*)malloc(capacity * sizeof(struct point_t));
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        struct point_t point;
+
+        if(line[0] == '#' || sscanf(line, "%31s", word) != 1)
+        {
+            continue;
+        }
+        if(strcmp(word, "schedule") == 0)
+        {
+            if(sscanf(line, "%*s %31s", word) == 1
+                && strcmp(word, "replica") == 0)
+            {
+                *schedule = SCHEDULE_REPLICA;
+            }
+            else if(strcmp(word, "team") == 0)
+            {
+                *schedule = SCHEDULE_TEAM;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: schedule must be replica or team\n");
+                exit(-1);
+            }
+            continue;
+        }
+        if(sscanf(line, "%d %d %d %d %d", &point.replicas,
+            &point.contagiousness_factor, &point.deadliness_factor,
+            &point.infection_radius, &point.duration_of_disease) != 5
+            || point.replicas < 1
+            || (constant->contact_engine == ENGINE_GRID
+            && count_cells(constant, point.infection_radius) > INT_MAX - 1)
+            || point.duration_of_disease > longest_duration)
+        {
+            fprintf(stderr, "ERROR: bad sweep line: %s", line);
+            exit(-1);
+        }
+        if(num_points == capacity)
+        {
+            capacity *= 2;
+            *points = (struct point_t*)realloc(*points,
+                capacity * sizeof(struct point_t));
+        }
+        (*points)[num_points] = point;
+        num_points++;
+    }
+    fclose(file);
+
+    return(num_points);
+}
+
+/*
+    run_replica()
+        Runs one simulation in the buffers of global and records the
+        counters of every day in day_counts
+*/
+void run_replica(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats, person_t *day_counts)
+{
+    reset_counters(global, stats);
+    if(constant->contact_engine == ENGINE_GRID)
+    {
+        set_grid(global, constant);
+    }
+    init_array(global, constant);
+
+    for(global->current_day = 0; global->current_day
+        <= constant->total_number_of_days; global->current_day++)
+    {
+        // With -F, once nobody is infected the counters stay as they
+        // are for the rest of the run, and nobody looks at where the
+        // people are
+        fast_forward_check(global, constant);
+        if(global->burned_out_day >= 0)
+        {
+            int current_day;
+
+            for(current_day = global->current_day;
+                current_day <= constant->total_number_of_days; current_day++)
+            {
+                person_t *counts = day_counts + current_day * NUM_DAY_COUNTERS;
+                counts[0] = global->num_susceptible;
+                counts[1] = global->num_infected;
+                counts[2] = global->num_immune;
+                counts[3] = global->num_dead;
+            }
+            break;
+        }
+
+        if(reorder_day(global, constant))
+        {
+            reorder(global, constant);
+        }
+        find_infected_engine(global, constant);
+        move(global, constant);
+        susceptible(global, constant, stats);
+        infected(global, constant, stats);
+        update_days_infected(global, constant);
+
+        person_t *counts = day_counts + global->current_day * NUM_DAY_COUNTERS;
+        counts[0] = global->num_susceptible;
+        counts[1] = global->num_infected;
+        counts[2] = global->num_immune;
+        counts[3] = global->num_dead;
+    }
+}
+
+/*
+    add_replica()
+        Adds the day counters of one replica to the sums of its point
+*/
+void add_replica(struct point_t *point, person_t *day_counts, int number_of_days)
+{
+    int current;
+
+    for(current = 0; current <= number_of_days * NUM_DAY_COUNTERS - 1;
+        current++)
+    {
+        point->sums[current] += day_counts[current];
+        point->squares[current] += (double)day_counts[current]
+            * day_counts[current];
+    }
+}
+
+/*
+    write_results()
+        Writes the mean and standard deviation of the counters of every
+        point and day as CSV
+*/
+void write_results(FILE *output, struct point_t *points, int num_points,
+    int number_of_days)
+{
+    int current_point;
+    int current_day;
+    int current_counter;
+
+    fprintf(output, "point,replicas,contagiousness_factor,deadliness_factor,"
+        "infection_radius,duration_of_disease,day,susceptible_mean,"
+        "susceptible_sd,infected_mean,infected_sd,immune_mean,immune_sd,"
+        "dead_mean,dead_sd\n");
+    for(current_point = 0; current_point <= num_points - 1; current_point++)
+    {
+        struct point_t *point = &points[current_point];
+
+        for(current_day = 0; current_day <= number_of_days - 1; current_day++)
+        {
+            fprintf(output, "%d,%d,%d,%d,%d,%d,%d", current_point,
+                point->replicas, point->contagiousness_factor,
+                point->deadliness_factor, point->infection_radius,
+                point->duration_of_disease, current_day);
+            for(current_counter = 0; current_counter
+                <= NUM_DAY_COUNTERS - 1; current_counter++)
+            {
+                int current = current_day * NUM_DAY_COUNTERS + current_counter;
+                double mean = point->sums[current] / point->replicas;
+                double variance = point->squares[current] / point->replicas
+                    - mean * mean;
+
+                fprintf(output, ",%.3f,%.3f", mean,
+                    variance > 0.0 ? sqrt(variance) : 0.0);
+            }
+            fprintf(output, "\n");
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    /**** In Defaults.h ****/
+    struct global_t global;
+    struct const_t constant;
+    struct stats_t stats;
+    struct display_t dpy;
+    /***********************/
+
+    struct point_t *points;
+    int num_points;
+    int schedule = SCHEDULE_AUTO;
+    int total_replicas = 0;
+    int smallest_radius;
+    int current_point;
+    FILE *output = stdout;
+
+    double start_ensemble = omp_get_wtime();
+
+    /***************** In Initialize.h *****************/
+    init_defaults(&global, &constant, &stats);
+    parse_args(&global, &constant, argc, argv);
+    init_check(&global, &constant);
+    select_nearby();
+    if(constant.numa_aware)
+    {
+        pin_threads();
+    }
+    /***************************************************/
+
+    if(optind >= argc)
+    {
+        fprintf(stderr, "Usage: %s [Pandemic options] sweep_file [output_file]\n",
+            argv[0]);
+        exit(-1);
+    }
+    num_points = read_sweep(argv[optind], &constant, &points, &schedule);
+    if(optind + 1 < argc)
+    {
+        output = fopen(argv[optind + 1], "w");
+        if(output == NULL)
+        {
+            fprintf(stderr, "ERROR: could not open output file %s\n",
+                argv[optind + 1]);
+            exit(-1);
+        }
+    }
+
+    // Every day of every point gets its sums; the grid is allocated for
+    // the smallest radius so that it fits every point
+    int number_of_days = constant.total_number_of_days + 1;
+    smallest_radius = constant.infection_radius;
+    for(current_point = 0; current_point <= num_points - 1; current_point++)
+    {
+        points[current_point].sums = (double*)calloc(number_of_days
+            * NUM_DAY_COUNTERS, sizeof(double));
+        points[current_point].squares = (double*)calloc(number_of_days
+            * NUM_DAY_COUNTERS, sizeof(double));
+        total_replicas += points[current_point].replicas;
+        if(current_point == 0
+            || points[current_point].infection_radius < smallest_radius)
+        {
+            smallest_radius = points[current_point].infection_radius;
+        }
+    }
+
+    if(schedule == SCHEDULE_AUTO)
+    {
+        schedule = global.number_of_people < ENSEMBLE_TEAM_SIZE
+            && total_replicas >= omp_get_max_threads() ?
+            SCHEDULE_REPLICA : SCHEDULE_TEAM;
+    }
+    constant.infection_radius = smallest_radius;
+
+    // With one replica per thread, the phases inside a replica run on a
+    // team of one
+    omp_set_max_active_levels(1);
+
+    #ifdef _OPENMP
+    #pragma omp parallel if(schedule == SCHEDULE_REPLICA)
+    #endif
+    {
+    // Each thread has its own buffers and reuses them for all of its
+    // replicas
+    struct global_t my_global = global;
+    struct const_t my_constant = constant;
+    struct stats_t my_stats = stats;
+    person_t *day_counts = (person_t*)malloc(number_of_days
+        * NUM_DAY_COUNTERS * sizeof(person_t));
+    int current_replica;
+
+    allocate_array(&my_global, &my_constant, &dpy);
+
+    #ifdef _OPENMP
+    #pragma omp for schedule(dynamic, 1)
+    #endif
+    for(current_replica = 0; current_replica <= total_replicas - 1;
+        current_replica++)
+    {
+        // Find the point of the replica
+        int first_replica = 0;
+        struct point_t *point = points;
+        while(current_replica >= first_replica + point->replicas)
+        {
+            first_replica += point->replicas;
+            point++;
+        }
+
+        my_constant.contagiousness_factor = point->contagiousness_factor;
+        my_constant.deadliness_factor = point->deadliness_factor;
+        my_constant.infection_radius = point->infection_radius;
+        my_constant.duration_of_disease = point->duration_of_disease;
+        my_constant.seed = constant.seed + current_replica;
+
+        run_replica(&my_global, &my_constant, &my_stats, day_counts);
+
+        #ifdef _OPENMP
+        #pragma omp critical
+        #endif
+        add_replica(point, day_counts, number_of_days);
+    }
+
+    cleanup(&my_global, &my_constant, &dpy);
+    free(day_counts);
+    }
+
+    write_results(output, points, num_points, number_of_days);
+    if(output != stdout)
+    {
+        fclose(output);
+    }
+
+    fprintf(stderr, "%d replicas of %d points (%s): %lf s\n", total_replicas,
+        num_points, schedule == SCHEDULE_REPLICA ? "replica per thread"
+        : "team per replica", omp_get_wtime() - start_ensemble);
+
+    for(current_point = 0; current_point <= num_points - 1; current_point++)
+    {
+        free(points[current_point].sums);
+        free(points[current_point].squares);
+    }
+    free(points);
+
+    exit(EXIT_SUCCESS);
+}
@@ -70,13 +70,39 @@ void cleanup(struct global_t *global, struct const_t *constant,
     free(dpy->environment);
     #endif
 
-    // free arrays allocated in global struct
-    free(global->x_locations);
-    free(global->y_locations);
+    // free arrays allocated in global struct; those of a restart are
+    // in the mapped snapshot
+    #ifdef COMPACT_LAYOUT
+    release_array(global, global->locations);
+    #else
+    release_array(global, global->x_locations);
+    release_array(global, global->y_locations);
+    #endif
+    release_array(global, global->infected_ids);
+    free(global->staged_ids);
     free(global->infected_y_locations);
     free(global->infected_x_locations);
-    free(global->states);
-    free(global->num_days_infected);
+    release_array(global, global->states);
+    release_array(global, global->num_days_infected);
+    release_array(global, global->person_ids);
+    free(global->reorder_keys);
+    free(global->reorder_scratch);
+    release_array(global, global->stamped_x_locations);
+    release_array(global, global->stamped_y_locations);
+    free(global->tile_bitmap);
+    free(global->slice_counts);
+    free(global->busy_times);
+    #ifdef PROFILE
+    free(global->profile_times);
+    #ifdef PERF_COUNTERS
+    free(global->profile_counts);
+    #endif
+    #endif
+    free(global->thread_totals);
+    free(global->cell_start);
+    free(global->cell_fill);
+    release_array(global, global->infection_raster);
+    checkpoint_cleanup(global);
 }
 
 #endif
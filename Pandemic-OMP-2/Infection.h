@@ -8,7 +8,48 @@
 #ifndef PANDEMIC_INFECTION_H
 #define PANDEMIC_INFECTION_H
 
+#include <omp.h>       // OpenMP
+
+#include "People.h"    // for the locations of people
+#include "Profile.h"   // for PROFILE_START, PROFILE_STOP
+
 void        find_infected(struct global_t *global);
+void        find_infected_grid(struct global_t *global,
+                struct const_t *constant);
+void        find_infected_raster(struct global_t *global,
+                struct const_t *constant);
+void        find_infected_team(struct global_t *global);
+void        find_infected_engine(struct global_t *global,
+                struct const_t *constant);
+void        find_infected_engine_team(struct global_t *global,
+                struct const_t *constant);
+void        find_infected_grid_team(struct global_t *global,
+                struct const_t *constant);
+void        find_infected_raster_team(struct global_t *global,
+                struct const_t *constant);
+void        find_infected_field(struct global_t *global,
+                struct const_t *constant);
+void        find_infected_field_team(struct global_t *global,
+                struct const_t *constant);
+void        change_footprint(struct global_t *global,
+                struct const_t *constant, person_t person_id, int new_x,
+                int new_y);
+void        add_to_row(struct global_t *global, struct const_t *constant,
+                int y, int first_x, int last_x, int value);
+void        find_infected_tiles_team(struct global_t *global,
+                struct const_t *constant);
+int         tile_marked(struct global_t *global, struct const_t *constant,
+                int x, int y);
+void        prefix_sum_team(person_t *values, person_t count,
+                person_t *block_totals);
+void        thread_block(person_t count, person_t *first, person_t *last);
+person_t    gather_blocks_team(person_t *staged, person_t first,
+                person_t count, person_t *destination,
+                person_t *block_totals);
+person_t    gather_slices_team(person_t *staged, person_t slice_size,
+                person_t num_slices, person_t *slice_counts,
+                person_t *destination, person_t *block_totals);
+person_t    list_infected_team(struct global_t *global);
 
 /*
     find_infected()
@@ -17,22 +58,800 @@ void        find_infected(struct global_t *global);
 */
 void find_infected(struct global_t *global)
 {
-    // counter to keep track of person in global struct
-    int current_person_id;
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    find_infected_team(global);
+}
+
+/*
+    find_infected_team()
+        The threads of the current team share the active infected list
+        and copy the locations of the infected people, in the order of
+        the list. Called by every thread of a parallel region.
+*/
+void find_infected_team(struct global_t *global)
+{
+    // counter to keep track of the infected people
+    person_t current_infected;
+
+    person_t num_infected = global->num_infected;
+
+    // pointers to arrays in global struct
+    person_t *infected_ids = global->infected_ids;
+    coord_t *infected_x_locations = global->infected_x_locations;
+    coord_t *infected_y_locations = global->infected_y_locations;
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_infected = 0; current_infected <= num_infected - 1;
+        current_infected++)
+    {
+        infected_x_locations[current_infected] =
+        person_x(global, infected_ids[current_infected]);
+        infected_y_locations[current_infected] =
+        person_y(global, infected_ids[current_infected]);
+    }
+}
+
+/*
+    find_infected_engine()
+        Each process gathers what the contact engine in use needs to
+        know about its infected people
+*/
+void find_infected_engine(struct global_t *global, struct const_t *constant)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    find_infected_engine_team(global, constant);
+}
+
+/*
+    find_infected_engine_team()
+        The threads of the current team gather what the contact engine
+        in use needs. Called by every thread of a parallel region.
+*/
+void find_infected_engine_team(struct global_t *global,
+    struct const_t *constant)
+{
+    // Once nobody is infected there is nothing to gather; the field is
+    // still kept, it unstamps the people who were infected
+    if(global->burned_out_day >= 0
+        && constant->contact_engine != ENGINE_FIELD)
+    {
+        return;
+    }
+
+    PROFILE_START(start_profile);
+
+    // The engine holds the locations of the whole list, even if the
+    // list is shortened before susceptible() runs
+    #ifdef _OPENMP
+    #pragma omp single nowait
+    #endif
+    global->num_infected_found = global->num_infected;
+
+    if(constant->contact_engine == ENGINE_GRID)
+    {
+        find_infected_grid_team(global, constant);
+    }
+    else if(constant->contact_engine == ENGINE_RASTER)
+    {
+        find_infected_raster_team(global, constant);
+    }
+    else if(constant->contact_engine == ENGINE_FIELD)
+    {
+        find_infected_field_team(global, constant);
+    }
+    else
+    {
+        find_infected_team(global);
+    }
+
+    if(global->tile_bitmap != NULL)
+    {
+        find_infected_tiles_team(global, constant);
+    }
+    PROFILE_STOP(global, PROFILE_FIND, global->current_day, start_profile);
+}
+
+/*
+    find_infected_grid()
+        Each process buckets its infected people by grid cell so that
+        susceptible() only has to look at the cells around a person.
+        The cells are as wide as the infection radius, so everyone who
+        can infect a person is in the person's cell or one of the 8
+        cells around it.
+*/
+void find_infected_grid(struct global_t *global, struct const_t *constant)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    find_infected_grid_team(global, constant);
+}
+
+/*
+    find_infected_grid_team()
+        The threads of the current team share the infected people and
+        bucket them by grid cell. Called by every thread of a
+        parallel region.
+*/
+void find_infected_grid_team(struct global_t *global,
+    struct const_t *constant)
+{
+    // counters
+    person_t current_infected;
+    person_t current_person_id;
+    int current_cell;
+    person_t num_infected = global->num_infected;
+
+    // grid dimensions
+    int cell_size = global->grid_cell_size;
+    int grid_width = global->grid_width;
+    int number_of_cells = global->grid_width * global->grid_height;
+
+    // pointers to arrays in global struct
+    person_t *infected_ids = global->infected_ids;
+    coord_t *infected_x_locations = global->infected_x_locations;
+    coord_t *infected_y_locations = global->infected_y_locations;
+    person_t *cell_start = global->cell_start;
+    person_t *cell_fill = global->cell_fill;
+
+    // Threads empty the cells
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_cell = 0; current_cell <= number_of_cells;
+        current_cell++)
+    {
+        cell_start[current_cell] = 0;
+    }
+
+    // Threads count the infected people of each cell, the count of
+    // cell c is kept in cell_start[c + 1]
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_infected = 0; current_infected <= num_infected - 1;
+        current_infected++)
+    {
+        current_person_id = infected_ids[current_infected];
+        current_cell = (person_y(global, current_person_id) / cell_size)
+            * grid_width + person_x(global, current_person_id) / cell_size;
+        #ifdef _OPENMP
+        #pragma omp atomic
+        #endif
+        cell_start[current_cell + 1]++;
+    }
+
+    // The counts become the index of the first infected person of
+    // each cell
+    prefix_sum_team(cell_start, number_of_cells + 1, global->thread_totals);
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_cell = 0; current_cell <= number_of_cells - 1;
+        current_cell++)
+    {
+        cell_fill[current_cell] = cell_start[current_cell];
+    }
+
+    // Threads put the infected locations in their cells, the order
+    // inside a cell does not matter
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_infected = 0; current_infected <= num_infected - 1;
+        current_infected++)
+    {
+        person_t current_infected_person;
+
+        current_person_id = infected_ids[current_infected];
+        current_cell = (person_y(global, current_person_id) / cell_size)
+            * grid_width + person_x(global, current_person_id) / cell_size;
+        #ifdef _OPENMP
+        #pragma omp atomic capture
+        #endif
+        current_infected_person = cell_fill[current_cell]++;
+
+        infected_x_locations[current_infected_person] =
+        person_x(global, current_person_id);
+        infected_y_locations[current_infected_person] =
+        person_y(global, current_person_id);
+    }
+}
+
+/*
+    find_infected_raster()
+        Each process counts, for every location of the environment, how
+        many of its infected people are within the infection radius.
+        Every infected person stamps the corners of its (2r-1)x(2r-1)
+        box into the raster, and a 2D prefix sum (a summed-area table
+        of the corners) turns the corners into the counts.
+*/
+void find_infected_raster(struct global_t *global, struct const_t *constant)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    find_infected_raster_team(global, constant);
+}
+
+/*
+    find_infected_raster_team()
+        The threads of the current team share the people and the
+        environment to build the raster. Called by every thread of a
+        parallel region.
+*/
+void find_infected_raster_team(struct global_t *global,
+    struct const_t *constant)
+{
+    // counters
+    person_t current_infected;
+    person_t current_person_id;
+    person_t num_infected = global->num_infected;
+
+    // environment and disease
+    int environment_width = constant->environment_width;
+    int environment_height = constant->environment_height;
+    int infection_radius = constant->infection_radius;
+
+    // pointers to arrays in global struct
+    person_t *infected_ids = global->infected_ids;
+    int *infection_raster = global->infection_raster;
+
+    long number_of_locations = (long)environment_width * environment_height;
+
+    long current_location;
+    int current_x;
+    int current_y;
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_location = 0; current_location <= number_of_locations - 1;
+        current_location++)
+    {
+        infection_raster[current_location] = 0;
+    }
+
+    // A person at (x, y) can be infected by an infected person at
+    // (ix, iy) if ix - r < x < ix + r and iy - r < y < iy + r.
+    // The box starts at +1 and is closed by -1 one past its right
+    // and bottom edges, clipped to the environment.
+    if(infection_radius >= 1)
+    {
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_infected = 0; current_infected <= num_infected - 1;
+        current_infected++)
+    {
+        current_person_id = infected_ids[current_infected];
+
+        int left = person_x(global, current_person_id) - infection_radius + 1;
+        int right = person_x(global, current_person_id) + infection_radius;
+        int top = person_y(global, current_person_id) - infection_radius + 1;
+        int bottom = person_y(global, current_person_id) + infection_radius;
+
+        left = left > 0 ? left : 0;
+        top = top > 0 ? top : 0;
+
+        #ifdef _OPENMP
+        #pragma omp atomic
+        #endif
+        infection_raster[(long)top * environment_width + left]++;
+        if(right < environment_width)
+        {
+            #ifdef _OPENMP
+            #pragma omp atomic
+            #endif
+            infection_raster[(long)top * environment_width + right]--;
+        }
+        if(bottom < environment_height)
+        {
+            #ifdef _OPENMP
+            #pragma omp atomic
+            #endif
+            infection_raster[(long)bottom * environment_width + left]--;
+        }
+        if(right < environment_width && bottom < environment_height)
+        {
+            #ifdef _OPENMP
+            #pragma omp atomic
+            #endif
+            infection_raster[(long)bottom * environment_width + right]++;
+        }
+    }
+    }
+
+    // Threads sum along the rows, each thread its own rows
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_y = 0; current_y <= environment_height - 1; current_y++)
+    {
+        int *row = infection_raster + (long)current_y * environment_width;
+        for(current_x = 1; current_x <= environment_width - 1; current_x++)
+        {
+            row[current_x] += row[current_x - 1];
+        }
+    }
+
+    // then down the columns, each thread its own columns, walking
+    // the rows in order so that the memory is read sequentially
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_x = 0; current_x <= environment_width - 1; current_x += 256)
+    {
+        int last_x = current_x + 256 < environment_width ?
+            current_x + 256 : environment_width;
+        int column;
+        for(current_y = 1; current_y <= environment_height - 1; current_y++)
+        {
+            int *row = infection_raster + (long)current_y * environment_width;
+            int *previous_row = row - environment_width;
+            for(column = current_x; column < last_x; column++)
+            {
+                row[column] += previous_row[column];
+            }
+        }
+    }
+}
+
+/*
+    find_infected_field()
+        Each process brings its infection field up to date. The field
+        is the raster of ENGINE_RASTER, but it is kept from day to day:
+        each infected person's box is stamped where the person was last
+        seen, and only the people who moved or were newly infected
+        since then change it.
+*/
+void find_infected_field(struct global_t *global, struct const_t *constant)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    find_infected_field_team(global, constant);
+}
+
+/*
+    find_infected_field_team()
+        The threads of the current team share the active infected list
+        and move the boxes of the people who are not where they were
+        stamped. People who stopped being infected were taken off the
+        field by infected(). Called by every thread of a parallel
+        region.
+*/
+void find_infected_field_team(struct global_t *global,
+    struct const_t *constant)
+{
+    person_t current_infected;
+    person_t current_person_id;
+    person_t num_infected = global->num_infected;
+
+    person_t *infected_ids = global->infected_ids;
+    int *stamped_x_locations = global->stamped_x_locations;
+    int *stamped_y_locations = global->stamped_y_locations;
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_infected = 0; current_infected <= num_infected - 1;
+        current_infected++)
+    {
+        current_person_id = infected_ids[current_infected];
+
+        int x = person_x(global, current_person_id);
+        int y = person_y(global, current_person_id);
+
+        if(stamped_x_locations[current_person_id] != x
+            || stamped_y_locations[current_person_id] != y)
+        {
+            change_footprint(global, constant, current_person_id, x, y);
+        }
+    }
+}
+
+/*
+    change_footprint()
+        Moves the person's box in the infection field from where it was
+        stamped to (new_x, new_y). A stamped location of -1 means the
+        person has no box yet, a new_x of -1 takes the box away. Only
+        the parts of the rows the two boxes do not share change, so a
+        step of one cell costs O(infection_radius). Safe for threads
+        moving different people at the same time.
+*/
+void change_footprint(struct global_t *global, struct const_t *constant,
+    person_t person_id, int new_x, int new_y)
+{
+    int radius = constant->infection_radius - 1;
+    int old_x = global->stamped_x_locations[person_id];
+    int old_y = global->stamped_y_locations[person_id];
+    int has_old = old_x >= 0;
+    int has_new = new_x >= 0;
+    int first_y;
+    int last_y;
+    int current_y;
+
+    global->stamped_x_locations[person_id] = new_x;
+    global->stamped_y_locations[person_id] = new_y;
+
+    // A person at (x, y) is within the radius of (ix, iy) if
+    // ix - r < x < ix + r and iy - r < y < iy + r, so the box reaches
+    // r - 1 cells each way; with a radius below 1 it is empty
+    if(radius < 0)
+    {
+        return;
+    }
+
+    first_y = has_old ? old_y - radius : new_y - radius;
+    last_y = has_old ? old_y + radius : new_y + radius;
+    if(has_new)
+    {
+        first_y = new_y - radius < first_y ? new_y - radius : first_y;
+        last_y = new_y + radius > last_y ? new_y + radius : last_y;
+    }
+
+    for(current_y = first_y; current_y <= last_y; current_y++)
+    {
+        int in_old = has_old && current_y >= old_y - radius
+            && current_y <= old_y + radius;
+        int in_new = has_new && current_y >= new_y - radius
+            && current_y <= new_y + radius;
+
+        if(in_old && in_new)
+        {
+            // the cells of the old part of the row the new part does
+            // not cover, and the other way around
+            int old_first = old_x - radius;
+            int old_last = old_x + radius;
+            int new_first = new_x - radius;
+            int new_last = new_x + radius;
+
+            if(old_first < new_first)
+            {
+                add_to_row(global, constant, current_y, old_first,
+                    old_last < new_first - 1 ? old_last : new_first - 1, -1);
+                add_to_row(global, constant, current_y,
+                    new_first > old_last + 1 ? new_first : old_last + 1,
+                    new_last, 1);
+            }
+            else if(new_first < old_first)
+            {
+                add_to_row(global, constant, current_y, new_first,
+                    new_last < old_first - 1 ? new_last : old_first - 1, 1);
+                add_to_row(global, constant, current_y,
+                    old_first > new_last + 1 ? old_first : new_last + 1,
+                    old_last, -1);
+            }
+        }
+        else if(in_old)
+        {
+            add_to_row(global, constant, current_y, old_x - radius,
+                old_x + radius, -1);
+        }
+        else if(in_new)
+        {
+            add_to_row(global, constant, current_y, new_x - radius,
+                new_x + radius, 1);
+        }
+    }
+}
+
+/*
+    add_to_row()
+        Adds value to the field from first_x to last_x of row y, clipped
+        to the environment
+*/
+void add_to_row(struct global_t *global, struct const_t *constant, int y,
+    int first_x, int last_x, int value)
+{
+    int current_x;
+    int environment_width = constant->environment_width;
+    int *row;
+
+    if(y < 0 || y >= constant->environment_height)
+    {
+        return;
+    }
+    first_x = first_x > 0 ? first_x : 0;
+    last_x = last_x < environment_width - 1 ? last_x : environment_width - 1;
+
+    row = global->infection_raster + (long)y * environment_width;
+    for(current_x = first_x; current_x <= last_x; current_x++)
+    {
+        #ifdef _OPENMP
+        #pragma omp atomic
+        #endif
+        row[current_x] += value;
+    }
+}
+
+/*
+    find_infected_tiles_team()
+        The threads of the current team clear the tile bitmap, then
+        mark every tile that some infected person's box reaches, so that
+        nobody in an unmarked tile can be infected today. Called by
+        every thread of a parallel region.
+*/
+void find_infected_tiles_team(struct global_t *global,
+    struct const_t *constant)
+{
+    person_t current_infected;
+    person_t num_infected = global->num_infected;
+    int tile_size = constant->tile_size;
+    int tiles_width = global->tiles_width;
+    int radius = constant->infection_radius - 1;
+    long num_words = ((long)tiles_width * global->tiles_height + 63) / 64;
+    long current_word;
+
+    person_t *infected_ids = global->infected_ids;
+    unsigned long *tile_bitmap = global->tile_bitmap;
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_word = 0; current_word <= num_words - 1; current_word++)
+    {
+        tile_bitmap[current_word] = 0;
+    }
+
+    // An empty box reaches no tile
+    if(radius >= 0)
+    {
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_infected = 0; current_infected <= num_infected - 1;
+        current_infected++)
+    {
+        person_t current_person_id = infected_ids[current_infected];
+        int x = person_x(global, current_person_id);
+        int y = person_y(global, current_person_id);
+        int first_x = x - radius > 0 ? x - radius : 0;
+        int last_x = x + radius < constant->environment_width - 1 ?
+            x + radius : constant->environment_width - 1;
+        int first_y = y - radius > 0 ? y - radius : 0;
+        int last_y = y + radius < constant->environment_height - 1 ?
+            y + radius : constant->environment_height - 1;
+        int tile_x;
+        int tile_y;
+
+        for(tile_y = first_y / tile_size; tile_y <= last_y / tile_size;
+            tile_y++)
+        {
+            for(tile_x = first_x / tile_size; tile_x <= last_x / tile_size;
+                tile_x++)
+            {
+                long tile = (long)tile_y * tiles_width + tile_x;
+                unsigned long bit = 1UL << (tile % 64);
+
+                // most tiles are marked by many people, so only write
+                // the word if the bit is not set yet
+                if((__atomic_load_n(&tile_bitmap[tile / 64], __ATOMIC_RELAXED)
+                    & bit) == 0)
+                {
+                    __atomic_fetch_or(&tile_bitmap[tile / 64], bit,
+                        __ATOMIC_RELAXED);
+                }
+            }
+        }
+    }
+    }
+}
+
+/*
+    tile_marked()
+        Returns 1 if the tile of (x, y) is marked in the tile bitmap
+*/
+int tile_marked(struct global_t *global, struct const_t *constant, int x,
+    int y)
+{
+    long tile = (long)(y / constant->tile_size) * global->tiles_width
+        + x / constant->tile_size;
+
+    return((global->tile_bitmap[tile / 64] >> (tile % 64)) & 1);
+}
+
+/*
+    prefix_sum_team()
+        Replaces each value with the sum of itself and all the values
+        before it. Each thread sums its own block, then the block totals
+        are added to the blocks after them. Called by every thread of a
+        parallel region; block_totals is shared and holds one more
+        entry than there are threads.
+*/
+void prefix_sum_team(person_t *values, person_t count,
+    person_t *block_totals)
+{
+    int rank = 0;
+    int threads = 1;
+    person_t current;
+    person_t first;
+    person_t last;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    threads = omp_get_num_threads();
+    #endif
+
+    thread_block(count, &first, &last);
+
+    for(current = first + 1; current < last; current++)
+    {
+        values[current] += values[current - 1];
+    }
+    block_totals[rank + 1] = last > first ? values[last - 1] : 0;
+
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #pragma omp single
+    #endif
+    {
+        block_totals[0] = 0;
+        for(current = 1; current <= threads; current++)
+        {
+            block_totals[current] += block_totals[current - 1];
+        }
+    }
+
+    for(current = first; current < last; current++)
+    {
+        values[current] += block_totals[rank];
+    }
+
+    // every block is done once every thread is here
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+}
+
+/*
+    thread_block()
+        Gives the calling thread its block of count items: thread r of
+        n gets the items from first to last - 1, r * count / n to
+        (r + 1) * count / n.
+*/
+void thread_block(person_t count, person_t *first, person_t *last)
+{
+    int rank = 0;
+    int threads = 1;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    threads = omp_get_num_threads();
+    #endif
+
+    *first = (person_t)((long)count * rank / threads);
+    *last = (person_t)((long)count * (rank + 1) / threads);
+}
+
+/*
+    gather_blocks_team()
+        Each thread has staged count values at staged[first] (the first
+        item of its thread_block()). The values of all the threads are
+        copied one after the other to destination, in the order of the
+        threads, so the result does not depend on timing. Returns the
+        number of values copied. Called by every thread of a parallel
+        region; block_totals is shared and holds one more entry than
+        there are threads.
+*/
+person_t gather_blocks_team(person_t *staged, person_t first,
+    person_t count, person_t *destination, person_t *block_totals)
+{
+    int rank = 0;
+    int threads = 1;
+    person_t current;
+    person_t total;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    threads = omp_get_num_threads();
+    #endif
+
+    block_totals[rank + 1] = count;
+
+    // One thread turns the counts into the first place of each block
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #pragma omp single
+    #endif
+    {
+        block_totals[0] = 0;
+        for(current = 1; current <= threads; current++)
+        {
+            block_totals[current] += block_totals[current - 1];
+        }
+    }
+
+    for(current = 0; current <= count - 1; current++)
+    {
+        destination[block_totals[rank] + current] = staged[first + current];
+    }
+    total = block_totals[threads];
+
+    // every value is in place once every thread is here
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+
+    return(total);
+}
+
+/*
+    gather_slices_team()
+        Slice s of slice_size items has staged slice_counts[s] values at
+        staged[s * slice_size]. The values of all the slices are copied
+        one after the other to destination, in the order of the slices,
+        so the result does not depend on which thread took which slice.
+        Returns the number of values copied. Called by every thread of
+        a parallel region once every count is written; the counts are
+        overwritten by their prefix sums.
+*/
+person_t gather_slices_team(person_t *staged, person_t slice_size,
+    person_t num_slices, person_t *slice_counts, person_t *destination,
+    person_t *block_totals)
+{
+    person_t current_slice;
+    person_t current;
+
+    prefix_sum_team(slice_counts, num_slices, block_totals);
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_slice = 0; current_slice <= num_slices - 1; current_slice++)
+    {
+        person_t place = current_slice > 0 ?
+            slice_counts[current_slice - 1] : 0;
+        person_t first = current_slice * slice_size;
+
+        for(current = 0; current <= slice_counts[current_slice] - place - 1;
+            current++)
+        {
+            destination[place + current] = staged[first + current];
+        }
+    }
+
+    return(num_slices > 0 ? slice_counts[num_slices - 1] : 0);
+}
+
+/*
+    list_infected_team()
+        The threads of the current team put the ids of all of the
+        infected people in the active infected list, in the order of the
+        people, and return its length. Called by every thread of a
+        parallel region.
+*/
+person_t list_infected_team(struct global_t *global)
+{
+    person_t current_person_id;
+    person_t num_infected_local = 0;
+    person_t first;
+    person_t last;
+
+    person_t *staged_ids = global->staged_ids;
 
-    int current_infected_person = 0;
-    for(current_person_id = 0; current_person_id <= global->number_of_people - 1; 
+    // Each thread stages the infected people of its block, and the
+    // blocks become the list
+    thread_block(global->number_of_people, &first, &last);
+    for(current_person_id = first; current_person_id <= last - 1;
         current_person_id++)
     {
-        if(global->states[current_person_id] == INFECTED)
+        if(person_state(global, current_person_id) == INFECTED)
         {
-            global->infected_x_locations[current_infected_person] = 
-            global->x_locations[current_person_id];
-            global->infected_y_locations[current_infected_person] =
-            global->y_locations[current_person_id];
-            current_infected_person++;
+            staged_ids[first + num_infected_local] = current_person_id;
+            num_infected_local++;
         }
     }
+    return(gather_blocks_team(staged_ids, first, num_infected_local,
+        global->infected_ids, global->thread_totals));
 }
 
-#endif
\ No newline at end of file
+#endif
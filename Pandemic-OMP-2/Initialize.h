@@ -9,15 +9,22 @@
 #define PANDEMIC_INITIALIZE_H
 
 #include <stdlib.h>     // for malloc, and various others
+#include <string.h>     // for strcmp
+#include <limits.h>     // for INT_MAX
 #include <unistd.h>     // for random, getopt, some others
 #include <time.h>       // for time is used to seed the random number generator
 #include <omp.h>       // OpenMP
 
-#include <trng/lcg64_shift.hpp>
-#include <trng/yarn2.hpp>
-#include <trng/uniform_dist.hpp>
-#include <trng/discrete_dist.hpp>
-#include <trng/uniform_int_dist.hpp>
+#include "Random.h"    // for random_int
+#include "People.h"    // for the locations and states of people
+#include "Nearby.h"    // for select_nearby
+#include "Placement.h" // for pin_threads, first_touch
+#include "Schedule.h"  // for schedule_reset
+#include "Checkpoint.h" // for checkpoint_open, checkpoint_map_arrays
+#include "Series.h"    // for the time series
+#include "Archive.h"   // for the replay archive
+#include "Render.h"    // for the offscreen frames
+#include "Profile.h"   // for profile_allocate
 
 
 
@@ -28,12 +35,18 @@
 
 int         init (struct global_t *global, struct const_t *constant,
                 struct stats_t *stats, struct display_t *dpy, int *c, char ***v);
+void        init_defaults(struct global_t *global, struct const_t *constant,
+                struct stats_t *stats);
+void        reset_counters(struct global_t *global, struct stats_t *stats);
 void        parse_args (struct global_t *global, struct const_t *constant,
                 int argc, char ** argv);
-void        init_check(struct global_t *global);
+person_t    parse_people(const char *text);
+void        init_check(struct global_t *global, struct const_t *constant);
 void        allocate_array(struct global_t *global,
                 struct const_t *constant, struct display_t *dpy);
 void        init_array(struct global_t *global, struct const_t *constant);
+void        set_grid(struct global_t *global, struct const_t *constant);
+long        count_cells(struct const_t *constant, int infection_radius);
 
 /*
     init()
@@ -46,6 +59,64 @@ int init (struct global_t *global, struct const_t *constant,
     int argc                        = *c;
     char ** argv                    = *v;
 
+    init_defaults(global, constant, stats);
+
+    // assign different colors for different states
+    #ifdef X_DISPLAY
+    dpy->red = "#FF0000";
+    dpy->green = "#00FF00";
+    dpy->black = "#000000";
+    dpy->white = "#FFFFFF";
+    #endif
+
+    parse_args(global, constant, argc, argv);
+
+    // Take the model and the counters from the snapshot
+    if(constant->restart_file != NULL)
+    {
+        checkpoint_open(global, constant, stats);
+    }
+
+    init_check(global, constant);
+
+    // Pick the neighbour test for this CPU
+    select_nearby();
+
+    // Pin the threads before they first touch the arrays
+    if(constant->numa_aware)
+    {
+        pin_threads();
+    }
+
+    allocate_array(global, constant, dpy);
+
+    // The random numbers are keyed on constant->seed, nothing to seed;
+    // a restart uses the people of the snapshot in place
+    if(constant->restart_file != NULL)
+    {
+        checkpoint_map_arrays(global, constant);
+    }
+    else
+    {
+        init_array(global, constant);
+    }
+
+    // if use X_DISPLAY, do init_display()
+    #ifdef X_DISPLAY
+        init_display(global, constant, dpy);
+    #endif
+
+    return(0);
+}
+
+/*
+    init_defaults()
+        Set the parameters of the simulation to their DEFAULT values
+        and clear the counters
+*/
+void init_defaults(struct global_t *global, struct const_t *constant,
+    struct stats_t *stats)
+{
     // initialize constant values using DEFAULT values
     constant->environment_width     = DEFAULT_ENVIRO_SIZE;
     constant->environment_height    = DEFAULT_ENVIRO_SIZE;
@@ -55,11 +126,43 @@ int init (struct global_t *global, struct const_t *constant,
     constant->deadliness_factor     = DEFAULT_DEAD_FACTOR;
     constant->total_number_of_days  = DEFAULT_DAYS;
     constant->microseconds_per_day  = DEFAULT_MICROSECS;
+    constant->contact_engine        = DEFAULT_ENGINE;
+    constant->persistent_team       = 0;
+    constant->seed                  = DEFAULT_SEED;
+    constant->reorder_days          = DEFAULT_REORDER_DAYS;
+    constant->numa_aware            = 0;
+    constant->tile_size             = DEFAULT_TILE_SIZE;
+    constant->adaptive_schedule     = 0;
+    constant->checkpoint_days       = DEFAULT_CHECKPOINT_DAYS;
+    constant->checkpoint_file       = DEFAULT_CHECKPOINT_FILE;
+    constant->restart_file          = NULL;
+    constant->series_file           = NULL;
+    constant->archive_file          = NULL;
+    constant->render_file           = NULL;
+    constant->render_days           = DEFAULT_RENDER_DAYS;
+    constant->x_draw                = DEFAULT_DRAW;
+    constant->fast_forward          = FAST_FORWARD_OFF;
 
     // initialize global people counters using DEFAULT values
     global->number_of_people        = DEFAULT_SIZE;
     global->num_initially_infected  = DEFAULT_INIT_INFECTED;
+    global->current_day             = 0;
+    global->checkpoint              = NULL;
+    global->snapshot_map            = NULL;
+    global->snapshot_size           = 0;
+    global->series                  = NULL;
+    global->archive                 = NULL;
+    global->render                  = NULL;
+
+    reset_counters(global, stats);
+}
 
+/*
+    reset_counters()
+        Clear the states counters and the stats before a simulation
+*/
+void reset_counters(struct global_t *global, struct stats_t *stats)
+{
     // initialize stats data in stats struct
     stats->num_infections = 0.0;
     stats->num_infection_attempts = 0.0;
@@ -72,32 +175,12 @@ int init (struct global_t *global, struct const_t *constant,
     global->num_immune = 0;
     global->num_dead = 0;
 
-    // assign different colors for different states
-    #ifdef X_DISPLAY
-    dpy->red = "#FF0000";
-    dpy->green = "#00FF00";
-    dpy->black = "#000000";
-    dpy->white = "#FFFFFF";
-    #endif
-
-    init_check(global);
-
-    parse_args(global, constant, argc, argv);
-
-    allocate_array(global, constant, dpy);
-
-    // Seeds the random number generator based on the current time
-    
-
-
-    init_array(global, constant);
+    // the epidemic has not burned out yet (-F)
+    global->burned_out_day = -1;
 
-    // if use X_DISPLAY, do init_display()
-    #ifdef X_DISPLAY
-        init_display(constant, dpy);
-    #endif
-
-    return(0);
+    // initialize the tile bitmap counters
+    global->num_tile_checks = 0;
+    global->num_tile_skips = 0;
 }
 
 /*
@@ -110,15 +193,15 @@ void parse_args(struct global_t *global, struct const_t *constant, int argc, cha
 
     // Get command line options -- this follows the idiom presented in the
     // getopt man page (enter 'man 3 getopt' on the shell for more)
-    while((c = getopt(argc, argv, "n:i:w:h:t:T:c:d:D:m:p:")) != -1)
+    while((c = getopt(argc, argv, "n:i:w:h:t:T:c:d:D:m:p:e:Ps:r:ab:Ak:f:R:o:z:v:V:x:F:")) != -1)
     {
         switch(c)
         {
             case 'n':
-            global->number_of_people = atoi(optarg);
+            global->number_of_people = parse_people(optarg);
             break;
             case 'i':
-            global->num_initially_infected = atoi(optarg);
+            global->num_initially_infected = parse_people(optarg);
             break;
             case 'w':
             constant->environment_width = atoi(optarg);
@@ -147,12 +230,107 @@ void parse_args(struct global_t *global, struct const_t *constant, int argc, cha
             case 'p':
             omp_set_num_threads(atoi(optarg));
             break;
+            case 'e':
+            if(strcmp(optarg, "brute") == 0)
+            {
+                constant->contact_engine = ENGINE_BRUTE;
+            }
+            else if(strcmp(optarg, "grid") == 0)
+            {
+                constant->contact_engine = ENGINE_GRID;
+            }
+            else if(strcmp(optarg, "raster") == 0)
+            {
+                constant->contact_engine = ENGINE_RASTER;
+            }
+            else if(strcmp(optarg, "field") == 0)
+            {
+                constant->contact_engine = ENGINE_FIELD;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: unknown contact engine '%s' (brute, grid, raster, field)\n",
+                    optarg);
+                exit(-1);
+            }
+            break;
+            case 'P':
+            constant->persistent_team = 1;
+            break;
+            case 's':
+            constant->seed = strtoul(optarg, NULL, 0);
+            break;
+            case 'r':
+            constant->reorder_days = atoi(optarg);
+            break;
+            case 'a':
+            constant->numa_aware = 1;
+            break;
+            case 'b':
+            constant->tile_size = atoi(optarg);
+            break;
+            case 'A':
+            constant->adaptive_schedule = 1;
+            break;
+            case 'k':
+            constant->checkpoint_days = atoi(optarg);
+            break;
+            case 'f':
+            constant->checkpoint_file = optarg;
+            break;
+            case 'R':
+            constant->restart_file = optarg;
+            break;
+            case 'o':
+            constant->series_file = optarg;
+            break;
+            case 'z':
+            constant->archive_file = optarg;
+            break;
+            case 'v':
+            constant->render_file = optarg;
+            break;
+            case 'V':
+            constant->render_days = atoi(optarg);
+            break;
+            case 'x':
+            if(strcmp(optarg, "rects") == 0)
+            {
+                constant->x_draw = DRAW_RECTANGLES;
+            }
+            else if(strcmp(optarg, "image") == 0)
+            {
+                constant->x_draw = DRAW_IMAGE;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: unknown X drawing '%s' (rects, image)\n",
+                    optarg);
+                exit(-1);
+            }
+            break;
+            case 'F':
+            if(strcmp(optarg, "skip") == 0)
+            {
+                constant->fast_forward = FAST_FORWARD_SKIP;
+            }
+            else if(strcmp(optarg, "lazy") == 0)
+            {
+                constant->fast_forward = FAST_FORWARD_LAZY;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: unknown fast-forward '%s' (skip, lazy)\n",
+                    optarg);
+                exit(-1);
+            }
+            break;
             // If the user entered "-?" or an unrecognized option, we need
             // to print a usage message before exiting.
             case '?':
             default:
             fprintf(stderr, "Usage: ");
-            fprintf(stderr, "%s [-n number_of_people][-i num_initially_infected][-w environment_width]\n[-h environment_height][-t total_number_of_days][-T duration_of_disease]\n[-c contagiousness_factor][-d infection_radius][-D deadliness_factor]\n[-m microseconds_per_day] [-p number of threads]\n", argv[0]);
+            fprintf(stderr, "%s [-n number_of_people][-i num_initially_infected][-w environment_width]\n[-h environment_height][-t total_number_of_days][-T duration_of_disease]\n[-c contagiousness_factor][-d infection_radius][-D deadliness_factor]\n[-m microseconds_per_day] [-p number of threads][-e brute|grid|raster|field][-P][-s seed][-r reorder_days][-a][-b tile_size][-A]\n[-k checkpoint_days][-f checkpoint_file][-R restart_file][-o series_file][-z archive_file]\n[-v frames_file][-V render_days][-x rects|image][-F skip|lazy]\n", argv[0]);
             exit(-1);
         }
     }
@@ -160,22 +338,84 @@ void parse_args(struct global_t *global, struct const_t *constant, int argc, cha
     argv += optind;
 }
 
+/*
+    parse_people()
+        Reads a number of people, which must fit in person_t
+*/
+person_t parse_people(const char *text)
+{
+    long number = atol(text);
+
+    if(number != (person_t)number)
+    {
+        fprintf(stderr, "ERROR: %ld people need a build with -DHUGE_POPULATION\n",
+            number);
+        exit(-1);
+    }
+    return((person_t)number);
+}
+
 /*
     init_check()
         Each process makes sure that the total number of initially
-        infected people is less than the total number of people
+        infected people is less than the total number of people, and
+        that the environment and disease fit the compact layout
 */
-void init_check(struct global_t *global)
+void init_check(struct global_t *global, struct const_t *constant)
 {
-    int num_initially_infected = global->num_initially_infected;
-    int number_of_people = global->number_of_people;
+    person_t num_initially_infected = global->num_initially_infected;
+    person_t number_of_people = global->number_of_people;
 
     if(num_initially_infected > number_of_people)
     {
-        fprintf(stderr, "ERROR: initial number of infected (%d) must be less than total number of people (%d)\n",
-            num_initially_infected, number_of_people);
+        fprintf(stderr, "ERROR: initial number of infected (%ld) must be less than total number of people (%ld)\n",
+            (long)num_initially_infected, (long)number_of_people);
+        exit(-1);
+    }
+
+    // The cells of the grid are ints, however many people there are
+    if(constant->contact_engine == ENGINE_GRID)
+    {
+        long number_of_cells = count_cells(constant,
+            constant->infection_radius);
+
+        if(number_of_cells > INT_MAX - 1)
+        {
+            fprintf(stderr, "ERROR: the grid holds up to %d cells, not %ld (raise -d)\n",
+                INT_MAX - 1, number_of_cells);
+            exit(-1);
+        }
+    }
+
+    if(constant->render_days < 1)
+    {
+        fprintf(stderr, "ERROR: the days between two frames (%d) must be at least 1\n",
+            constant->render_days);
+        exit(-1);
+    }
+
+    if(constant->tile_size < 0)
+    {
+        fprintf(stderr, "ERROR: the tile size (%d) must be at least 0 (0 for no tile bitmap)\n",
+            constant->tile_size);
+        exit(-1);
+    }
+
+    #ifdef COMPACT_LAYOUT
+    if(constant->environment_width > COMPACT_MAX_ENVIRO_SIZE
+        || constant->environment_height > COMPACT_MAX_ENVIRO_SIZE)
+    {
+        fprintf(stderr, "ERROR: the compact layout holds environments up to %d x %d\n",
+            COMPACT_MAX_ENVIRO_SIZE, COMPACT_MAX_ENVIRO_SIZE);
         exit(-1);
     }
+    if(constant->duration_of_disease > COMPACT_MAX_DURATION)
+    {
+        fprintf(stderr, "ERROR: the compact layout holds diseases up to %d days\n",
+            COMPACT_MAX_DURATION);
+        exit(-1);
+    }
+    #endif
 }
 
 /*
@@ -185,15 +425,120 @@ void init_check(struct global_t *global)
 void allocate_array(struct global_t *global, struct const_t *constant,
     struct display_t *dpy)
 {
-    int number_of_people = global->number_of_people;
+    person_t number_of_people = global->number_of_people;
+
+    // Allocate the arrays in global struct, on huge pages (Placement.h)
+    #ifdef COMPACT_LAYOUT
+    global->locations = (unsigned int*)allocate_pages(number_of_people
+        * sizeof(unsigned int));
+    global->states = (unsigned char*)allocate_pages((number_of_people
+        + 3) / 4);
+    #else
+    global->x_locations = (int*)allocate_pages(number_of_people
+        * sizeof(int));
+    global->y_locations = (int*)allocate_pages(number_of_people
+        * sizeof(int));
+    global->states = (char*)allocate_pages(number_of_people * sizeof(char));
+    #endif
+    global->infected_ids = (person_t*)allocate_pages(number_of_people
+        * sizeof(person_t));
+    global->staged_ids = (person_t*)allocate_pages(number_of_people
+        * sizeof(person_t));
+    global->infected_x_locations = (coord_t*)allocate_pages(number_of_people
+        * sizeof(coord_t));
+    global->infected_y_locations = (coord_t*)allocate_pages(number_of_people
+        * sizeof(coord_t));
+    global->num_days_infected = (days_t*)allocate_pages(number_of_people
+        * sizeof(days_t));
+    global->person_ids = (person_t*)allocate_pages(number_of_people
+        * sizeof(person_t));
+
+    // Allocate the room to reorder the people
+    global->reorder_keys = NULL;
+    global->reorder_scratch = NULL;
+    if(constant->reorder_days > 0)
+    {
+        global->reorder_keys = (struct reorder_key_t*)allocate_pages(
+            number_of_people * sizeof(struct reorder_key_t));
+        global->reorder_scratch = (person_t*)allocate_pages(number_of_people
+            * sizeof(person_t));
+    }
+
+    // Allocate the totals of the threads' blocks in prefix sums
+    global->thread_totals = (person_t*)malloc((omp_get_max_threads() + 1)
+        * sizeof(person_t));
+
+    // Allocate the counts of the slices of susceptible(), which are
+    // never smaller than SCHEDULE_MIN_CHUNK people nor fewer than the
+    // threads, and the busy times of the threads
+    global->slice_counts = (person_t*)allocate_pages((number_of_people
+        / SCHEDULE_MIN_CHUNK + omp_get_max_threads() + 1)
+        * sizeof(person_t));
+    global->busy_times = NULL;
+    if(constant->adaptive_schedule)
+    {
+        global->busy_times = (double*)malloc(omp_get_max_threads()
+            * sizeof(double));
+    }
+    schedule_reset(global, constant);
+
+    // Allocate the times of the profile
+    #ifdef PROFILE
+    profile_allocate(global, constant);
+    #endif
+
+    // Allocate the grid over the infected people, one cell per
+    // infection_radius square of the environment
+    global->cell_start = NULL;
+    global->cell_fill = NULL;
+    if(constant->contact_engine == ENGINE_GRID)
+    {
+        set_grid(global, constant);
+        global->cell_start = (person_t*)allocate_pages(((long)global->grid_width
+            * global->grid_height + 1) * sizeof(person_t));
+        global->cell_fill = (person_t*)allocate_pages((long)global->grid_width
+            * global->grid_height * sizeof(person_t));
+    }
+
+    // Allocate the infection pressure raster, one counter per location
+    global->infection_raster = NULL;
+    if(constant->contact_engine == ENGINE_RASTER
+        || constant->contact_engine == ENGINE_FIELD)
+    {
+        global->infection_raster = (int*)allocate_pages(
+            (long)constant->environment_width
+            * constant->environment_height * sizeof(int));
+    }
+
+    // Allocate where each person is stamped in the infection field
+    global->stamped_x_locations = NULL;
+    global->stamped_y_locations = NULL;
+    if(constant->contact_engine == ENGINE_FIELD)
+    {
+        global->stamped_x_locations = (int*)allocate_pages(number_of_people
+            * sizeof(int));
+        global->stamped_y_locations = (int*)allocate_pages(number_of_people
+            * sizeof(int));
+    }
 
-    // Allocate the arrays in global struct
-    global->x_locations = (int*)malloc(number_of_people * sizeof(int));
-    global->y_locations = (int*)malloc(number_of_people * sizeof(int));
-    global->infected_x_locations = (int*)malloc(number_of_people * sizeof(int));
-    global->infected_y_locations = (int*)malloc(number_of_people * sizeof(int));
-    global->states = (char*)malloc(number_of_people * sizeof(char));
-    global->num_days_infected = (int*)malloc(number_of_people * sizeof(int));
+    // Allocate the tile bitmap
+    global->tile_bitmap = NULL;
+    if(constant->tile_size > 0)
+    {
+        global->tiles_width = (constant->environment_width
+            + constant->tile_size - 1) / constant->tile_size;
+        global->tiles_height = (constant->environment_height
+            + constant->tile_size - 1) / constant->tile_size;
+        global->tile_bitmap = (unsigned long*)allocate_pages(
+            ((long)global->tiles_width * global->tiles_height + 63) / 64
+            * sizeof(unsigned long));
+    }
+
+    // The threads place the pages of their own blocks
+    if(constant->numa_aware)
+    {
+        first_touch(global, constant);
+    }
 
     // Allocate the arrays for text display
     #ifdef TEXT_DISPLAY
@@ -218,75 +563,35 @@ void allocate_array(struct global_t *global, struct const_t *constant,
 void init_array(struct global_t *global, struct const_t *constant)
 {
     // counter to keep track of current person
-    int current_person_id;
+    person_t current_person_id;
 
-    int number_of_people = global->number_of_people;
-    int num_initially_infected = global->num_initially_infected;
+    person_t number_of_people = global->number_of_people;
+    person_t num_initially_infected = global->num_initially_infected;
+    int field_engine = constant->contact_engine == ENGINE_FIELD;
 
     // OMP does not support reduction to struct, create local instance
     // and then put local instance back to struct
-    int num_infected_local = global->num_infected;
-    int num_susceptible_local = global->num_susceptible;
+    person_t num_infected_local = global->num_infected;
+    person_t num_susceptible_local = global->num_susceptible;
 
-    // Process spawns threads to set the states of the initially
-    // infected people and set the count of its infected people
+    // Process spawns threads that stream through their own blocks of
+    // people once, writing all of a person's arrays together. A block is
+    // the one the thread has in the phases, so its pages are first
+    // touched by the thread that works on them.
     #ifdef _OPENMP
-    #pragma omp parallel for private(current_person_id) \
-        reduction(+:num_infected_local)
+    #pragma omp parallel private(current_person_id) \
+        reduction(+:num_infected_local, num_susceptible_local)
     #endif
-    for(current_person_id = 0; current_person_id
-        <= num_initially_infected - 1; current_person_id++)
     {
-        global->states[current_person_id] = INFECTED;
-        num_infected_local++;
-    }
-    global->num_infected = num_infected_local;
-
-    // Process spawns threads to set the states of the rest of
-    // its people and set the count of its susceptible people
+    // With COMPACT_LAYOUT the states are set by flipping bits, so the
+    // packed states start from all zeros; a byte may be shared by two
+    // blocks, so all of them are cleared before any state is set
+    #ifdef COMPACT_LAYOUT
+    first_touch_team(global->states, (number_of_people + 3) / 4);
     #ifdef _OPENMP
-    #pragma omp parallel for private(current_person_id) \
-        reduction(+:num_susceptible_local)
+    #pragma omp barrier
     #endif
-    for(current_person_id = num_initially_infected;
-        current_person_id <= number_of_people - 1;
-        current_person_id++)
-    {
-        global->states[current_person_id] = SUSCEPTIBLE;
-        num_susceptible_local++;
-    }
-    global->num_susceptible = num_susceptible_local;
-
-    // Process spawns threads to set random x and y locations for
-    // each of its people
-
-
-
-    int num_threads;
-    int rank;
-    int x, y;
-
-    #ifdef _OPENMP
-    #pragma omp parallel private(current_person_id, num_threads, rank,x ,y)
     #endif
-    {
-    trng::yarn2 streamx, streamy;
-
-
-    num_threads = omp_get_num_threads();
-    rank = omp_get_thread_num();
-
-    streamx.split(2,0);
-    streamy.split(2,1);
-
-    streamx.split(num_threads, rank);
-    streamy.split(num_threads, rank);
-
-
-    trng::uniform_int_dist distx(0, constant ->environment_width);
-    trng::uniform_int_dist disty(0, constant ->environment_height);
-
-
 
     #ifdef _OPENMP
     #pragma omp for
@@ -295,24 +600,88 @@ void init_array(struct global_t *global, struct const_t *constant)
         current_person_id <= number_of_people - 1;
         current_person_id++)
     {
+        // The first people are the initially infected ones, and start
+        // the active infected list
+        if(current_person_id <= num_initially_infected - 1)
+        {
+            set_person_state(global, current_person_id, INFECTED);
+            global->infected_ids[current_person_id] = current_person_id;
+            num_infected_local++;
+        }
+        else
+        {
+            set_person_state(global, current_person_id, SUSCEPTIBLE);
+            num_susceptible_local++;
+        }
 
         // global->x_locations[current_person_id] = random() % constant->environment_width;
         // global->y_locations[current_person_id] = random() % constant->environment_height;
-        global->x_locations[current_person_id] = distx(streamx);
-        global->y_locations[current_person_id] = disty(streamy);
+        set_person_location(global, current_person_id,
+            random_int(constant->seed, 0, current_person_id,
+                RANDOM_X_LOCATION, constant->environment_width),
+            random_int(constant->seed, 0, current_person_id,
+                RANDOM_Y_LOCATION, constant->environment_height));
+
+        // Nobody has been infected for a day yet, and everyone keeps
+        // their first id
+        global->num_days_infected[current_person_id] = 0;
+        global->person_ids[current_person_id] = current_person_id;
+
+        // Nobody is stamped in the infection field yet
+        if(field_engine)
+        {
+            global->stamped_x_locations[current_person_id] = -1;
+            global->stamped_y_locations[current_person_id] = -1;
+        }
     }
-  }
-    // Process spawns threads to initialize the number of days
-    // infected of each of its people to 0
-    #ifdef _OPENMP
-    #pragma omp parallel for private(current_person_id)
-    #endif
-    for(current_person_id = 0;
-        current_person_id <= number_of_people - 1;
-        current_person_id++)
+    }
+    global->num_infected = num_infected_local;
+    global->num_susceptible = num_susceptible_local;
+
+    // The infection field starts empty
+    if(field_engine)
     {
-        global->num_days_infected[current_person_id] = 0;
+        long number_of_locations = (long)constant->environment_width
+            * constant->environment_height;
+        long current_location;
+
+        #ifdef _OPENMP
+        #pragma omp parallel for private(current_location)
+        #endif
+        for(current_location = 0; current_location
+            <= number_of_locations - 1; current_location++)
+        {
+            global->infection_raster[current_location] = 0;
+        }
     }
 }
 
+/*
+    set_grid()
+        Size the grid over the infected people for the infection
+        radius. A smaller radius needs more cells, so the arrays
+        allocated for one radius also fit any larger radius.
+*/
+void set_grid(struct global_t *global, struct const_t *constant)
+{
+    global->grid_cell_size = constant->infection_radius > 1 ?
+        constant->infection_radius : 1;
+    global->grid_width = (constant->environment_width
+        + global->grid_cell_size - 1) / global->grid_cell_size;
+    global->grid_height = (constant->environment_height
+        + global->grid_cell_size - 1) / global->grid_cell_size;
+}
+
+/*
+    count_cells()
+        Returns the cells set_grid() makes for the infection radius
+*/
+long count_cells(struct const_t *constant, int infection_radius)
+{
+    long cell_size = infection_radius > 1 ? infection_radius : 1;
+
+    return((constant->environment_width + cell_size - 1) / cell_size
+        * ((constant->environment_height + cell_size - 1) / cell_size));
+}
+
 #endif
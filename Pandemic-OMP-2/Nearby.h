@@ -0,0 +1,204 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_NEARBY_H
+#define PANDEMIC_NEARBY_H
+
+/* Tests whether any of a range of infected locations is within the
+ * infection radius of a location. The vector kernels test 8 (AVX2) or
+ * 16 (AVX-512) infected people per comparison and stop at the first
+ * block with a hit; the one to use is picked from the CPU at run time.
+ * Compile with SCALAR_NEARBY to always use the scalar loop. */
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(SCALAR_NEARBY)
+#define VECTOR_NEARBY
+#include <immintrin.h>  // for the AVX2 and AVX-512 intrinsics
+#endif
+
+int         nearby_scalar(coord_t *infected_x_locations,
+                coord_t *infected_y_locations, person_t count, int x, int y,
+                int infection_radius);
+#ifdef VECTOR_NEARBY
+int         nearby_avx2(coord_t *infected_x_locations,
+                coord_t *infected_y_locations, person_t count, int x, int y,
+                int infection_radius);
+int         nearby_avx512(coord_t *infected_x_locations,
+                coord_t *infected_y_locations, person_t count, int x, int y,
+                int infection_radius);
+#endif
+void        select_nearby(void);
+const char *nearby_name(void);
+
+// The kernel picked by select_nearby()
+int (*infected_nearby)(coord_t *infected_x_locations,
+    coord_t *infected_y_locations, person_t count, int x, int y,
+    int infection_radius) = nearby_scalar;
+
+/*
+    nearby_scalar()
+        Returns 1 if one of the count infected people is within the
+        infection radius of (x, y), 0 otherwise
+*/
+int nearby_scalar(coord_t *infected_x_locations,
+    coord_t *infected_y_locations, person_t count, int x, int y,
+    int infection_radius)
+{
+    person_t my_person;
+
+    for(my_person = 0; my_person <= count - 1; my_person++)
+    {
+        if((x > infected_x_locations[my_person] - infection_radius)
+            && (x < infected_x_locations[my_person] + infection_radius)
+            && (y > infected_y_locations[my_person] - infection_radius)
+            && (y < infected_y_locations[my_person] + infection_radius))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#ifdef VECTOR_NEARBY
+/*
+    nearby_avx2()
+        nearby_scalar() on 8 infected people at a time. x > ix - r and
+        x < ix + r are tested as ix < x + r and ix > x - r, so the
+        bounds are computed once for the person.
+*/
+__attribute__((target("avx2")))
+int nearby_avx2(coord_t *infected_x_locations,
+    coord_t *infected_y_locations, person_t count, int x, int y,
+    int infection_radius)
+{
+    person_t my_person;
+
+    __m256i x_low = _mm256_set1_epi32(x - infection_radius);
+    __m256i x_high = _mm256_set1_epi32(x + infection_radius);
+    __m256i y_low = _mm256_set1_epi32(y - infection_radius);
+    __m256i y_high = _mm256_set1_epi32(y + infection_radius);
+
+    for(my_person = 0; my_person <= count - 8; my_person += 8)
+    {
+        #ifdef COMPACT_LAYOUT
+        __m256i infected_x = _mm256_cvtepu16_epi32(_mm_loadu_si128(
+            (__m128i*)(infected_x_locations + my_person)));
+        __m256i infected_y = _mm256_cvtepu16_epi32(_mm_loadu_si128(
+            (__m128i*)(infected_y_locations + my_person)));
+        #else
+        __m256i infected_x = _mm256_loadu_si256(
+            (__m256i*)(infected_x_locations + my_person));
+        __m256i infected_y = _mm256_loadu_si256(
+            (__m256i*)(infected_y_locations + my_person));
+        #endif
+
+        __m256i nearby = _mm256_and_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(infected_x, x_low),
+                _mm256_cmpgt_epi32(x_high, infected_x)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(infected_y, y_low),
+                _mm256_cmpgt_epi32(y_high, infected_y)));
+
+        if(_mm256_movemask_epi8(nearby) != 0)
+        {
+            return 1;
+        }
+    }
+
+    // the last people that do not fill a vector
+    return(nearby_scalar(infected_x_locations + my_person,
+        infected_y_locations + my_person, count - my_person, x, y,
+        infection_radius));
+}
+
+/*
+    nearby_avx512()
+        nearby_avx2() on 16 infected people at a time, the comparisons
+        give a mask directly
+*/
+__attribute__((target("avx512f")))
+int nearby_avx512(coord_t *infected_x_locations,
+    coord_t *infected_y_locations, person_t count, int x, int y,
+    int infection_radius)
+{
+    person_t my_person;
+
+    __m512i x_low = _mm512_set1_epi32(x - infection_radius);
+    __m512i x_high = _mm512_set1_epi32(x + infection_radius);
+    __m512i y_low = _mm512_set1_epi32(y - infection_radius);
+    __m512i y_high = _mm512_set1_epi32(y + infection_radius);
+
+    for(my_person = 0; my_person <= count - 16; my_person += 16)
+    {
+        #ifdef COMPACT_LAYOUT
+        __m512i infected_x = _mm512_maskz_cvtepu16_epi32(0xffff,
+            _mm256_loadu_si256((__m256i*)(infected_x_locations + my_person)));
+        __m512i infected_y = _mm512_maskz_cvtepu16_epi32(0xffff,
+            _mm256_loadu_si256((__m256i*)(infected_y_locations + my_person)));
+        #else
+        __m512i infected_x = _mm512_loadu_si512(
+            infected_x_locations + my_person);
+        __m512i infected_y = _mm512_loadu_si512(
+            infected_y_locations + my_person);
+        #endif
+
+        __mmask16 nearby = _mm512_cmpgt_epi32_mask(infected_x, x_low);
+        nearby = _mm512_mask_cmpgt_epi32_mask(nearby, x_high, infected_x);
+        nearby = _mm512_mask_cmpgt_epi32_mask(nearby, infected_y, y_low);
+        nearby = _mm512_mask_cmpgt_epi32_mask(nearby, y_high, infected_y);
+
+        if(nearby != 0)
+        {
+            return 1;
+        }
+    }
+
+    // the last people that do not fill a vector
+    return(nearby_scalar(infected_x_locations + my_person,
+        infected_y_locations + my_person, count - my_person, x, y,
+        infection_radius));
+}
+#endif
+
+/*
+    select_nearby()
+        Picks the widest kernel the CPU supports
+*/
+void select_nearby(void)
+{
+    infected_nearby = nearby_scalar;
+    #ifdef VECTOR_NEARBY
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+    {
+        infected_nearby = nearby_avx512;
+    }
+    else if(__builtin_cpu_supports("avx2"))
+    {
+        infected_nearby = nearby_avx2;
+    }
+    #endif
+}
+
+/*
+    nearby_name()
+        The name of the kernel in use, for the results
+*/
+const char *nearby_name(void)
+{
+    #ifdef VECTOR_NEARBY
+    if(infected_nearby == nearby_avx512)
+    {
+        return("avx512");
+    }
+    if(infected_nearby == nearby_avx2)
+    {
+        return("avx2");
+    }
+    #endif
+    return("scalar");
+}
+
+#endif
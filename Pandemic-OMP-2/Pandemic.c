@@ -11,11 +11,15 @@
 #include <unistd.h>     // for random, getopt, some others
 #ifdef X_DISPLAY
 #include <X11/Xlib.h>   // for X display
+#ifdef X_SHM
+#include <X11/extensions/XShm.h>    // for MIT-SHM images
+#endif
 #endif
 
 #include "Defaults.h"
 #include "Initialize.h"
 #include "Infection.h"
+#include "Reorder.h"
 #include "Core.h"
 #include "Finalize.h"
 #include <omp.h>
@@ -33,33 +37,252 @@ int main(int argc, char ** argv)
     struct display_t dpy;
     /***********************/
 
+    PROFILE_START(start_profile);
     double start_init=omp_get_wtime();
     /***************** In Initialize.h *****************/
     init(&global, &constant, &stats, &dpy, &argc, &argv);
     /***************************************************/
+    PROFILE_STOP(&global, PROFILE_INIT, -1, start_profile);
     double final_init=omp_get_wtime()- start_init;
     // printf("Initialization time:%lf\n", final_init);
 
+    // A restart carries on from the day after its snapshot
+    int first_day = global.current_day;
+
+    /****** In Checkpoint.h ******/
+    checkpoint_start(&global, &constant);
+    /*****************************/
+
+    /****** In Series.h ******/
+    series_start(&global, &constant);
+    /*************************/
+
+    /****** In Archive.h ******/
+    archive_start(&global, &constant);
+    /**************************/
+
+    /****** In Render.h ******/
+    render_start(&global, &constant);
+    /*************************/
+
     double start_core= omp_get_wtime();
     // Process starts a loop to run the simulation for the
     // specified number of days
-    double move_total;
-    double sus_total;
-    double infected_total;
-    double days_total;
+    double reorder_total = 0.0;
+    double find_total = 0.0;
+    double move_total = 0.0;
+    double sus_total = 0.0;
+    double infected_total = 0.0;
+    double days_total = 0.0;
+    // the fraction of the susceptible people the tile bitmap skips
+    long tile_checks_seen = 0;
+    long tile_skips_seen = 0;
+    double tile_skip_sum = 0.0;
+    double tile_skip_min = 1.0;
+    double tile_skip_max = 0.0;
+    int tile_days = 0;
+
+    /****** In Core.h ******/
+    int defer_moves = fast_forward_defers(&global, &constant);
+    /***********************/
 
+    if(constant.persistent_team)
+    {
+    // One team of threads runs every day. The phases share the people
+    // between the threads with orphaned loops and end with a barrier;
+    // the master thread keeps the time.
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+    int current_day;
+    double start_phase = 0.0;
+
+    for(current_day = first_day; current_day <= constant.total_number_of_days;
+        current_day++)
+    {
+        #ifdef _OPENMP
+        #pragma omp single
+        #endif
+        {
+        global.current_day = current_day;
+        fast_forward_check(&global, &constant);
+        }
+
+        // Once nobody is infected (-F) only the counts are left to
+        // record, if nothing else needs the people moved every day
+        if(global.burned_out_day >= 0 && defer_moves)
+        {
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            series_push(&global, current_day);
+            continue;
+        }
+
+        /****** In Reorder.h ******/
+        if(reorder_day(&global, &constant))
+        {
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            start_phase = omp_get_wtime();
+            PROFILE_START(start_reorder);
+            reorder_team(&global, &constant);
+            PROFILE_STOP(&global, PROFILE_REORDER, current_day, start_reorder);
+            #ifdef _OPENMP
+            #pragma omp master
+            #endif
+            reorder_total += omp_get_wtime() - start_phase;
+        }
+        /**************************/
+
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        start_phase = omp_get_wtime();
 
-    for(global.current_day = 0; global.current_day <= constant.total_number_of_days;
+        /****** In Infection.h ******/
+        find_infected_engine_team(&global, &constant);
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        find_total += omp_get_wtime() - start_phase;
+        /****************************/
+
+        /****** In Render.h ******/
+        render_day_team(&global, &constant, current_day);
+        /*************************/
+
+        /**************** In Display.h *****************/
+        #if defined(X_DISPLAY) || defined(TEXT_DISPLAY)
+        #ifdef _OPENMP
+        #pragma omp single
+        #endif
+        {
+        PROFILE_START(start_display);
+        do_display(&global, &constant, &dpy);
+        PROFILE_STOP(&global, PROFILE_DISPLAY, current_day, start_display);
+
+        throttle(&constant);
+        }
+        #endif
+        /***********************************************/
+
+        /************** In Core.h *************/
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        start_phase = omp_get_wtime();
+        move_team(&global, &constant);
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        {
+        move_total += omp_get_wtime() - start_phase;
+        start_phase = omp_get_wtime();
+        }
+        susceptible_team(&global, &constant, &stats);
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        {
+        sus_total += omp_get_wtime() - start_phase;
+        if(global.num_tile_checks > tile_checks_seen)
+        {
+            double tile_skip_fraction =
+                (double)(global.num_tile_skips - tile_skips_seen)
+                / (global.num_tile_checks - tile_checks_seen);
+
+            tile_skip_sum += tile_skip_fraction;
+            tile_skip_min = tile_skip_fraction < tile_skip_min ?
+                tile_skip_fraction : tile_skip_min;
+            tile_skip_max = tile_skip_fraction > tile_skip_max ?
+                tile_skip_fraction : tile_skip_max;
+            tile_days++;
+            tile_checks_seen = global.num_tile_checks;
+            tile_skips_seen = global.num_tile_skips;
+        }
+        start_phase = omp_get_wtime();
+        }
+        infected_team(&global, &constant, &stats);
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        {
+        infected_total += omp_get_wtime() - start_phase;
+        start_phase = omp_get_wtime();
+        }
+        update_days_infected_team(&global, &constant);
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        days_total += omp_get_wtime() - start_phase;
+        /**************************************/
+
+        /****** In Checkpoint.h ******/
+        checkpoint_day_team(&global, &constant, &stats, current_day);
+        /*****************************/
+
+        /****** In Series.h ******/
+        #ifdef _OPENMP
+        #pragma omp master
+        #endif
+        series_push(&global, current_day);
+        /*************************/
+
+        /****** In Archive.h ******/
+        archive_day_team(&global, &constant, current_day);
+        /**************************/
+    }
+    }
+    global.current_day = constant.total_number_of_days + 1;
+    }
+    else
+    {
+    for(global.current_day = first_day; global.current_day <= constant.total_number_of_days;
         global.current_day++)
     {
+        fast_forward_check(&global, &constant);
+
+        // Once nobody is infected (-F) only the counts are left to
+        // record, if nothing else needs the people moved every day
+        if(global.burned_out_day >= 0 && defer_moves)
+        {
+            series_push(&global, global.current_day);
+            continue;
+        }
+
+        /****** In Reorder.h ******/
+        if(reorder_day(&global, &constant))
+        {
+            double start_reorder=omp_get_wtime();
+            PROFILE_START(start_profile);
+            reorder(&global, &constant);
+            PROFILE_STOP(&global, PROFILE_REORDER, global.current_day,
+                start_profile);
+            reorder_total = reorder_total + omp_get_wtime() - start_reorder;
+        }
+        /**************************/
+
         /****** In Infection.h ******/
-        find_infected(&global);
+        double start_find=omp_get_wtime();
+        find_infected_engine(&global, &constant);
+        double end_find=omp_get_wtime()- start_find;
+        find_total = find_total + end_find;
         /****************************/
 
+        /****** In Render.h ******/
+        render_day(&global, &constant);
+        /*************************/
+
         /**************** In Display.h *****************/
         #if defined(X_DISPLAY) || defined(TEXT_DISPLAY)
 
+        PROFILE_START(start_display);
         do_display(&global, &constant, &dpy);
+        PROFILE_STOP(&global, PROFILE_DISPLAY, global.current_day,
+            start_display);
 
         throttle(&constant);
 
@@ -76,6 +299,21 @@ int main(int argc, char ** argv)
         susceptible(&global, &constant, &stats);
         double end_sus=omp_get_wtime()- start_sus;
         sus_total = sus_total + end_sus;
+        if(global.num_tile_checks > tile_checks_seen)
+        {
+            double tile_skip_fraction =
+                (double)(global.num_tile_skips - tile_skips_seen)
+                / (global.num_tile_checks - tile_checks_seen);
+
+            tile_skip_sum += tile_skip_fraction;
+            tile_skip_min = tile_skip_fraction < tile_skip_min ?
+                tile_skip_fraction : tile_skip_min;
+            tile_skip_max = tile_skip_fraction > tile_skip_max ?
+                tile_skip_fraction : tile_skip_max;
+            tile_days++;
+            tile_checks_seen = global.num_tile_checks;
+            tile_skips_seen = global.num_tile_skips;
+        }
 
         double start_infected=omp_get_wtime();
         infected(&global, &constant, &stats);
@@ -87,9 +325,61 @@ int main(int argc, char ** argv)
         double end_days=omp_get_wtime()- start_days;
         days_total = days_total + end_days;
         /**************************************/
+
+        /****** In Checkpoint.h ******/
+        checkpoint_day(&global, &constant, &stats);
+        /*****************************/
+
+        /****** In Series.h ******/
+        series_push(&global, global.current_day);
+        /*************************/
+
+        /****** In Archive.h ******/
+        archive_day(&global, &constant);
+        /**************************/
+    }
+    }
+    /****** In Core.h ******/
+    if(global.burned_out_day >= 0 && defer_moves
+        && constant.fast_forward == FAST_FORWARD_LAZY)
+    {
+        double start_move = omp_get_wtime();
+        move_lazy(&global, &constant, global.burned_out_day,
+            constant.total_number_of_days);
+        move_total = move_total + omp_get_wtime() - start_move;
+    }
+    /***********************/
+    double day_time = omp_get_wtime() - start_core;
+    checkpoint_finish(&global);
+    series_finish(&global, &constant);
+    archive_finish(&global, &constant, day_time);
+    render_finish(&global, day_time);
+    printf("Nearby kernel: %s\n", nearby_name());
+    if(constant.reorder_days > 0)
+    {
+        printf("Reorder time: %lf\n", reorder_total);
     }
+    printf("Find infected time: %lf\n", find_total);
     // printf("Move time: %lf\n", move_total);
     printf("Sus time: %lf\n",sus_total);
+    if(tile_days > 0)
+    {
+        printf("Tile skip fraction: %lf (daily min %lf, max %lf)\n",
+            tile_skip_sum / tile_days, tile_skip_min, tile_skip_max);
+    }
+    schedule_report(&global, &constant);
+    if(global.burned_out_day >= 0)
+    {
+        printf("Fast-forward: nobody infected from day %d of %d, moves %s\n",
+            global.burned_out_day, constant.total_number_of_days,
+            !defer_moves ? "made every day"
+            : constant.fast_forward == FAST_FORWARD_LAZY
+            ? "made at the end" : "skipped");
+    }
+    checkpoint_report(&global, day_time);
+    #ifdef PROFILE
+    profile_report(&global);
+    #endif
     // printf("Infected time: %lf\n",infected_total);
     // printf("Update days time: %lf\n", days_total);
 
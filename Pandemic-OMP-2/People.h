@@ -0,0 +1,109 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_PEOPLE_H
+#define PANDEMIC_PEOPLE_H
+
+/* Access to the location, state and days infected of each person.
+ * By default these are plain arrays (an int per coordinate, a char per
+ * state, an int per days counter). With COMPACT_LAYOUT a person's x and
+ * y are 16 bit halves of one 32 bit word, the state takes 2 bits (4
+ * people per byte) and the days counter (days_t, in Defaults.h) 8 bits. */
+
+#ifdef COMPACT_LAYOUT
+// 2 bit codes of the states, and the states of the codes
+const unsigned char SUSCEPTIBLE_CODE = 0;
+const unsigned char INFECTED_CODE = 1;
+const unsigned char IMMUNE_CODE = 2;
+const unsigned char DEAD_CODE = 3;
+const char STATE_OF_CODE[4] = {SUSCEPTIBLE, INFECTED, IMMUNE, DEAD};
+
+// The largest environment and disease the compact layout can hold
+const int COMPACT_MAX_ENVIRO_SIZE = 65536;
+const int COMPACT_MAX_DURATION = 255;
+#endif
+
+inline int  person_x(struct global_t *global, person_t person_id);
+inline int  person_y(struct global_t *global, person_t person_id);
+inline void set_person_location(struct global_t *global, person_t person_id,
+                int x, int y);
+inline char person_state(struct global_t *global, person_t person_id);
+inline void set_person_state(struct global_t *global, person_t person_id,
+                char state);
+
+inline int person_x(struct global_t *global, person_t person_id)
+{
+    #ifdef COMPACT_LAYOUT
+    return(global->locations[person_id] & 0xffff);
+    #else
+    return(global->x_locations[person_id]);
+    #endif
+}
+
+inline int person_y(struct global_t *global, person_t person_id)
+{
+    #ifdef COMPACT_LAYOUT
+    return(global->locations[person_id] >> 16);
+    #else
+    return(global->y_locations[person_id]);
+    #endif
+}
+
+inline void set_person_location(struct global_t *global, person_t person_id,
+    int x, int y)
+{
+    #ifdef COMPACT_LAYOUT
+    global->locations[person_id] = (unsigned int)x | ((unsigned int)y << 16);
+    #else
+    global->x_locations[person_id] = x;
+    global->y_locations[person_id] = y;
+    #endif
+}
+
+/*
+    person_state()
+        With COMPACT_LAYOUT, the byte may be changed by another thread
+        (for another person) at the same time, so it is read atomically.
+*/
+inline char person_state(struct global_t *global, person_t person_id)
+{
+    #ifdef COMPACT_LAYOUT
+    unsigned char packed = __atomic_load_n(&global->states[person_id >> 2],
+        __ATOMIC_RELAXED);
+    return(STATE_OF_CODE[(packed >> ((person_id & 3) * 2)) & 3]);
+    #else
+    return(global->states[person_id]);
+    #endif
+}
+
+/*
+    set_person_state()
+        With COMPACT_LAYOUT, the 4 people of a byte may belong to
+        different threads. Only the thread handling a person changes its
+        2 bits, so it flips them from their current to the new code with
+        one atomic xor, which leaves the other people's bits alone.
+*/
+inline void set_person_state(struct global_t *global, person_t person_id,
+    char state)
+{
+    #ifdef COMPACT_LAYOUT
+    unsigned char *packed = &global->states[person_id >> 2];
+    int shift = (person_id & 3) * 2;
+    unsigned char current = (__atomic_load_n(packed, __ATOMIC_RELAXED)
+        >> shift) & 3;
+    unsigned char code = state == INFECTED ? INFECTED_CODE
+        : state == IMMUNE ? IMMUNE_CODE
+        : state == DEAD ? DEAD_CODE : SUSCEPTIBLE_CODE;
+
+    __atomic_fetch_xor(packed, (unsigned char)((current ^ code) << shift),
+        __ATOMIC_RELAXED);
+    #else
+    global->states[person_id] = state;
+    #endif
+}
+
+#endif
@@ -0,0 +1,255 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_PLACEMENT_H
+#define PANDEMIC_PLACEMENT_H
+
+#include <stdio.h>      // for fprintf
+#include <stdlib.h>     // for posix_memalign, malloc
+#include <string.h>     // for memset, strncmp
+#include <sys/mman.h>   // for madvise
+#include <sched.h>      // for sched_getaffinity, sched_setaffinity
+#include <dirent.h>     // for opendir, to find the node of a cpu
+#include <omp.h>       // OpenMP
+
+/* NUMA-aware placement (-a). Each thread is pinned to one cpu, and every
+ * array is first written by the threads in the same blocks the phases
+ * use (thread_block() and the static omp for), so that the pages of a
+ * thread's people are on the memory of its own socket.
+ *
+ * The arrays of the people are allocated on huge page boundaries and
+ * the kernel is asked to back them with transparent huge pages: with
+ * billions of people, 4 KB pages would take millions of TLB entries. */
+
+// Size of a huge page, and the smallest array worth aligning to one
+const long HUGE_PAGE_SIZE = 2L * 1024 * 1024;
+
+void        *allocate_pages(long size);
+int         cpu_node(int cpu);
+void        pin_threads(void);
+void        first_touch_team(void *array, long size);
+void        first_touch(struct global_t *global, struct const_t *constant);
+
+/*
+    allocate_pages()
+        Allocates size bytes, on a huge page boundary and advised to be
+        backed by huge pages if the array fills at least one. Nothing is
+        touched, the pages are placed by the threads that first write
+        them. The array is released with free(). Exits if there is not
+        enough memory.
+*/
+void *allocate_pages(long size)
+{
+    void *array = NULL;
+
+    if(size < HUGE_PAGE_SIZE)
+    {
+        array = malloc(size > 0 ? size : 1);
+    }
+    else if(posix_memalign(&array, HUGE_PAGE_SIZE, size) == 0)
+    {
+        #ifdef MADV_HUGEPAGE
+        madvise(array, size, MADV_HUGEPAGE);
+        #endif
+    }
+    else
+    {
+        array = NULL;
+    }
+
+    if(array == NULL)
+    {
+        fprintf(stderr, "ERROR: cannot allocate %ld bytes\n", size);
+        exit(-1);
+    }
+    return(array);
+}
+
+/*
+    cpu_node()
+        Returns the NUMA node of the cpu, 0 if the system does not say
+*/
+int cpu_node(int cpu)
+{
+    char path[64];
+    DIR *directory;
+    struct dirent *entry;
+    int node = 0;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    directory = opendir(path);
+    if(directory == NULL)
+    {
+        return(0);
+    }
+    while((entry = readdir(directory)) != NULL)
+    {
+        if(strncmp(entry->d_name, "node", 4) == 0
+            && sscanf(entry->d_name + 4, "%d", &node) == 1)
+        {
+            break;
+        }
+    }
+    closedir(directory);
+
+    return(node);
+}
+
+/*
+    pin_threads()
+        Pins each thread of the team to a cpu the process may use and
+        prints the placement map. The cpus are taken in order of their
+        node, spread evenly over the threads, so threads with
+        neighbouring blocks share a socket. If OMP_PROC_BIND already
+        binds the threads they are left where they are.
+*/
+void pin_threads(void)
+{
+    cpu_set_t allowed;
+    int cpus[CPU_SETSIZE];
+    int nodes[CPU_SETSIZE];
+    int num_cpus = 0;
+    int current;
+    int bound = omp_get_proc_bind() != omp_proc_bind_false;
+
+    // the cpus the process may use, each inserted after the cpus of
+    // the same or lower nodes
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for(current = 0; current <= CPU_SETSIZE - 1; current++)
+    {
+        if(CPU_ISSET(current, &allowed))
+        {
+            int node = cpu_node(current);
+            int place = num_cpus;
+
+            while(place > 0 && nodes[place - 1] > node)
+            {
+                nodes[place] = nodes[place - 1];
+                cpus[place] = cpus[place - 1];
+                place--;
+            }
+            nodes[place] = node;
+            cpus[place] = current;
+            num_cpus++;
+        }
+    }
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        int rank = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        int my_cpu;
+
+        if(!bound)
+        {
+            cpu_set_t mine;
+
+            CPU_ZERO(&mine);
+            CPU_SET(cpus[(long)rank * num_cpus / threads], &mine);
+            sched_setaffinity(0, sizeof(mine), &mine);
+        }
+
+        my_cpu = sched_getcpu();
+        #ifdef _OPENMP
+        #pragma omp for ordered schedule(static, 1)
+        #endif
+        for(current = 0; current <= threads - 1; current++)
+        {
+            #ifdef _OPENMP
+            #pragma omp ordered
+            #endif
+            fprintf(stderr, "thread %d: cpu %d node %d%s\n", rank, my_cpu,
+                cpu_node(my_cpu), bound ? " (OMP_PROC_BIND)" : "");
+        }
+    }
+}
+
+/*
+    first_touch_team()
+        Each thread of the team zeroes its block of the array, which
+        places the pages of the block on the thread's node
+*/
+void first_touch_team(void *array, long size)
+{
+    int rank = 0;
+    int threads = 1;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    threads = omp_get_num_threads();
+    #endif
+
+    if(array != NULL)
+    {
+        long first = size * rank / threads;
+        long last = size * (rank + 1) / threads;
+
+        memset((char*)array + first, 0, last - first);
+    }
+}
+
+/*
+    first_touch()
+        The threads that will work on the people first touch the
+        person arrays, the active infected list and the engine arrays
+*/
+void first_touch(struct global_t *global, struct const_t *constant)
+{
+    long number_of_people = global->number_of_people;
+    long number_of_cells = (long)global->grid_width * global->grid_height;
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+    #ifdef COMPACT_LAYOUT
+    first_touch_team(global->locations,
+        number_of_people * sizeof(unsigned int));
+    first_touch_team(global->states, (number_of_people + 3) / 4);
+    #else
+    first_touch_team(global->x_locations, number_of_people * sizeof(int));
+    first_touch_team(global->y_locations, number_of_people * sizeof(int));
+    first_touch_team(global->states, number_of_people * sizeof(char));
+    #endif
+    first_touch_team(global->num_days_infected,
+        number_of_people * sizeof(days_t));
+    first_touch_team(global->person_ids, number_of_people * sizeof(person_t));
+    first_touch_team(global->infected_ids, number_of_people * sizeof(person_t));
+    first_touch_team(global->staged_ids, number_of_people * sizeof(person_t));
+    first_touch_team(global->infected_x_locations,
+        number_of_people * sizeof(coord_t));
+    first_touch_team(global->infected_y_locations,
+        number_of_people * sizeof(coord_t));
+    first_touch_team(global->reorder_keys,
+        number_of_people * sizeof(struct reorder_key_t));
+    first_touch_team(global->reorder_scratch,
+        number_of_people * sizeof(person_t));
+    first_touch_team(global->stamped_x_locations,
+        number_of_people * sizeof(int));
+    first_touch_team(global->stamped_y_locations,
+        number_of_people * sizeof(int));
+    if(global->cell_start != NULL)
+    {
+        first_touch_team(global->cell_start,
+            (number_of_cells + 1) * sizeof(person_t));
+        first_touch_team(global->cell_fill,
+            number_of_cells * sizeof(person_t));
+    }
+    if(global->tile_bitmap != NULL)
+    {
+        first_touch_team(global->tile_bitmap, ((long)global->tiles_width
+            * global->tiles_height + 63) / 64 * sizeof(unsigned long));
+    }
+    first_touch_team(global->infection_raster,
+        (long)constant->environment_width * constant->environment_height
+        * sizeof(int));
+    }
+}
+
+#endif
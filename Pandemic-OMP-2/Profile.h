@@ -0,0 +1,521 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_PROFILE_H
+#define PANDEMIC_PROFILE_H
+
+#include <stdio.h>      // for printf, fopen
+#include <stdlib.h>     // for calloc, getenv
+#include <string.h>     // for strlen, strcmp
+#include <omp.h>       // OpenMP
+
+#ifdef PERF_COUNTERS
+#include "Counters.h"  // for counters_read, counters_any
+#endif
+
+/* Per-phase, per-thread timing, compiled in with -DPROFILE. Each thread
+ * adds the time it spends in a phase to its own slot of the day, so the
+ * hooks take no locks. The phases of Core.h stop their clocks before
+ * the barrier that ends them, so a thread's time is the time it was
+ * busy and the slowest thread over the mean of the threads is the load
+ * imbalance of the phase. At exit the totals are printed and every
+ * slot is written to the file named by PANDEMIC_PROFILE (profile.csv
+ * by default), as JSON if the name ends with ".json", CSV otherwise.
+ * With PERF_COUNTERS the hooks also read the thread's hardware
+ * counters, see Counters.h. Without PROFILE the hooks are empty and
+ * global_t has no profile arrays, so the build is the same as before. */
+
+// Phases of the profile
+const int PROFILE_INIT = 0;
+const int PROFILE_REORDER = 1;
+const int PROFILE_FIND = 2;
+const int PROFILE_DISPLAY = 3;
+const int PROFILE_MOVE = 4;
+const int PROFILE_SUSCEPTIBLE = 5;
+const int PROFILE_INFECTED = 6;
+const int PROFILE_UPDATE_DAYS = 7;
+const int NUM_PROFILE_PHASES = 8;
+
+#if defined(PERF_COUNTERS)
+// The clock also reads the counters, before the time starts and after
+// it stops
+#define PROFILE_START(start) double start##_counts[NUM_COUNTERS]; \
+    counters_read(start##_counts); \
+    double start = omp_get_wtime()
+#define PROFILE_STOP(global, phase, day, start) \
+    profile_record(global, phase, day, omp_get_wtime() - (start)); \
+    profile_record_counts(global, phase, day, start##_counts)
+#elif defined(PROFILE)
+// Starts a clock named start, and adds the time since it started to
+// the calling thread's slot of the phase on the day
+#define PROFILE_START(start) double start = omp_get_wtime()
+#define PROFILE_STOP(global, phase, day, start) \
+    profile_record(global, phase, day, omp_get_wtime() - (start))
+#else
+#define PROFILE_START(start)
+#define PROFILE_STOP(global, phase, day, start)
+#endif
+
+#ifdef PROFILE
+const char  *profile_name(int phase);
+void        profile_allocate(struct global_t *global,
+                struct const_t *constant);
+long        profile_index(struct global_t *global, int phase, int day);
+double      *profile_slot(struct global_t *global, int phase, int day);
+void        profile_record(struct global_t *global, int phase, int day,
+                double seconds);
+#ifdef PERF_COUNTERS
+void        profile_record_counts(struct global_t *global, int phase,
+                int day, double *start_counts);
+void        profile_phase_counts(struct global_t *global, int phase,
+                int thread, double *counts);
+#endif
+int         profile_day_used(struct global_t *global, int phase, int day);
+double      profile_slowest(struct global_t *global, int phase, int day);
+double      profile_imbalance(struct global_t *global, int phase, int day);
+int         profile_totals(struct global_t *global, int phase,
+                double *seconds, double *imbalance);
+void        profile_write_csv(struct global_t *global, FILE *file);
+void        profile_write_json(struct global_t *global, FILE *file);
+void        profile_report(struct global_t *global);
+
+/*
+    profile_name()
+        Returns the name of the phase
+*/
+const char *profile_name(int phase)
+{
+    const char *names[] = {"init", "reorder", "find_infected", "display",
+        "move", "susceptible", "infected", "update_days"};
+
+    return(names[phase]);
+}
+
+/*
+    profile_allocate()
+        Allocates a cleared slot for every thread, phase and day; the
+        first day is -1, the initialization before the first day
+*/
+void profile_allocate(struct global_t *global, struct const_t *constant)
+{
+    global->profile_threads = omp_get_max_threads();
+    global->profile_days = constant->total_number_of_days + 2;
+    global->profile_times = (double*)calloc((long)global->profile_days
+        * NUM_PROFILE_PHASES * global->profile_threads, sizeof(double));
+    #ifdef PERF_COUNTERS
+    global->profile_counts = (double*)calloc((long)global->profile_days
+        * NUM_PROFILE_PHASES * global->profile_threads * NUM_COUNTERS,
+        sizeof(double));
+    #endif
+}
+
+/*
+    profile_index()
+        Returns the place of the first thread's slot of the phase on
+        the day
+*/
+long profile_index(struct global_t *global, int phase, int day)
+{
+    return(((long)(day + 1) * NUM_PROFILE_PHASES + phase)
+        * global->profile_threads);
+}
+
+/*
+    profile_slot()
+        Returns the times of the threads in the phase on the day
+*/
+double *profile_slot(struct global_t *global, int phase, int day)
+{
+    return(global->profile_times + profile_index(global, phase, day));
+}
+
+/*
+    profile_record()
+        Adds seconds to the calling thread's time in the phase on the
+        day; days outside the run are not recorded
+*/
+void profile_record(struct global_t *global, int phase, int day,
+    double seconds)
+{
+    int rank = 0;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    #endif
+
+    if(day >= -1 && day <= global->profile_days - 2
+        && rank <= global->profile_threads - 1)
+    {
+        profile_slot(global, phase, day)[rank] += seconds;
+    }
+}
+
+#ifdef PERF_COUNTERS
+/*
+    profile_record_counts()
+        Adds the counts since start_counts to the calling thread's
+        counts in the phase on the day
+*/
+void profile_record_counts(struct global_t *global, int phase, int day,
+    double *start_counts)
+{
+    double counts[NUM_COUNTERS];
+    int rank = 0;
+    int counter;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    #endif
+
+    counters_read(counts);
+    if(day >= -1 && day <= global->profile_days - 2
+        && rank <= global->profile_threads - 1)
+    {
+        double *slot = global->profile_counts
+            + (profile_index(global, phase, day) + rank) * NUM_COUNTERS;
+
+        for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+        {
+            slot[counter] += counts[counter] - start_counts[counter];
+        }
+    }
+}
+
+/*
+    profile_phase_counts()
+        Sums the counts of the phase over the days, for one thread or
+        for all of them if thread is -1
+*/
+void profile_phase_counts(struct global_t *global, int phase, int thread,
+    double *counts)
+{
+    int day;
+    int current;
+    int counter;
+
+    for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+    {
+        counts[counter] = 0.0;
+    }
+    for(day = -1; day <= global->profile_days - 2; day++)
+    {
+        for(current = 0; current <= global->profile_threads - 1; current++)
+        {
+            double *slot = global->profile_counts
+                + (profile_index(global, phase, day) + current)
+                * NUM_COUNTERS;
+
+            if(thread == -1 || thread == current)
+            {
+                for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+                {
+                    counts[counter] += slot[counter];
+                }
+            }
+        }
+    }
+}
+#endif
+
+/*
+    profile_day_used()
+        Returns 1 if a thread recorded a time in the phase on the day
+*/
+int profile_day_used(struct global_t *global, int phase, int day)
+{
+    return(profile_slowest(global, phase, day) > 0.0);
+}
+
+/*
+    profile_slowest()
+        Returns the time of the slowest thread in the phase on the day
+*/
+double profile_slowest(struct global_t *global, int phase, int day)
+{
+    double *times = profile_slot(global, phase, day);
+    double slowest = 0.0;
+    int current;
+
+    for(current = 0; current <= global->profile_threads - 1; current++)
+    {
+        if(times[current] > slowest)
+        {
+            slowest = times[current];
+        }
+    }
+    return(slowest);
+}
+
+/*
+    profile_imbalance()
+        Returns the time of the slowest thread over the mean time of the
+        threads in the phase on the day, 1 if no thread recorded one. A
+        phase one thread runs has the number of threads.
+*/
+double profile_imbalance(struct global_t *global, int phase, int day)
+{
+    double *times = profile_slot(global, phase, day);
+    double total = 0.0;
+    int current;
+
+    for(current = 0; current <= global->profile_threads - 1; current++)
+    {
+        total += times[current];
+    }
+    if(total <= 0.0)
+    {
+        return(1.0);
+    }
+    return(profile_slowest(global, phase, day) * global->profile_threads
+        / total);
+}
+
+/*
+    profile_totals()
+        Sums the time of the slowest thread in the phase over the days
+        and averages its imbalance over the days it ran (1 if none).
+        Returns the number of days the phase ran.
+*/
+int profile_totals(struct global_t *global, int phase, double *seconds,
+    double *imbalance)
+{
+    int day;
+    int days_used = 0;
+
+    *seconds = 0.0;
+    *imbalance = 0.0;
+    for(day = -1; day <= global->profile_days - 2; day++)
+    {
+        if(profile_day_used(global, phase, day))
+        {
+            *seconds += profile_slowest(global, phase, day);
+            *imbalance += profile_imbalance(global, phase, day);
+            days_used++;
+        }
+    }
+    *imbalance = days_used > 0 ? *imbalance / days_used : 1.0;
+
+    return(days_used);
+}
+
+/*
+    profile_write_csv()
+        Writes one line per thread, phase and day the phase ran, with
+        the counts of the thread if there are counters
+*/
+void profile_write_csv(struct global_t *global, FILE *file)
+{
+    int day;
+    int phase;
+    int current;
+    #ifdef PERF_COUNTERS
+    int counter;
+    #endif
+
+    fprintf(file, "day,phase,thread,seconds");
+    #ifdef PERF_COUNTERS
+    for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+    {
+        fprintf(file, ",%s", counter_name(counter));
+    }
+    #endif
+    fprintf(file, "\n");
+    for(day = -1; day <= global->profile_days - 2; day++)
+    {
+        for(phase = 0; phase <= NUM_PROFILE_PHASES - 1; phase++)
+        {
+            if(profile_day_used(global, phase, day))
+            {
+                double *times = profile_slot(global, phase, day);
+
+                for(current = 0; current <= global->profile_threads - 1;
+                    current++)
+                {
+                    fprintf(file, "%d,%s,%d,%.9f", day,
+                        profile_name(phase), current, times[current]);
+                    #ifdef PERF_COUNTERS
+                    for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+                    {
+                        fprintf(file, ",%.0f", global->profile_counts[
+                            (profile_index(global, phase, day) + current)
+                            * NUM_COUNTERS + counter]);
+                    }
+                    #endif
+                    fprintf(file, "\n");
+                }
+            }
+        }
+    }
+}
+
+/*
+    profile_write_json()
+        Writes the totals of every phase and the times of its threads
+        on every day, the first list of times being day -1, and the
+        counts of every thread over the run if there are counters
+*/
+void profile_write_json(struct global_t *global, FILE *file)
+{
+    int day;
+    int phase;
+    int current;
+    #ifdef PERF_COUNTERS
+    int counter;
+    double counts[NUM_COUNTERS];
+    #endif
+
+    fprintf(file, "{\n  \"threads\": %d,\n  \"first_day\": -1,\n  \"phases\": [\n",
+        global->profile_threads);
+    for(phase = 0; phase <= NUM_PROFILE_PHASES - 1; phase++)
+    {
+        double seconds;
+        double imbalance;
+
+        profile_totals(global, phase, &seconds, &imbalance);
+        fprintf(file, "    {\"name\": \"%s\", \"seconds\": %.9f, \"imbalance\": %.6f,\n     \"times\": [",
+            profile_name(phase), seconds, imbalance);
+        for(day = -1; day <= global->profile_days - 2; day++)
+        {
+            double *times = profile_slot(global, phase, day);
+
+            fprintf(file, "%s[", day > -1 ? ",\n       " : "");
+            for(current = 0; current <= global->profile_threads - 1;
+                current++)
+            {
+                fprintf(file, "%s%.9f", current > 0 ? ", " : "",
+                    times[current]);
+            }
+            fprintf(file, "]");
+        }
+        fprintf(file, "]");
+        #ifdef PERF_COUNTERS
+        for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+        {
+            fprintf(file, ",\n     \"%s\": [", counter_name(counter));
+            for(current = 0; current <= global->profile_threads - 1;
+                current++)
+            {
+                profile_phase_counts(global, phase, current, counts);
+                fprintf(file, "%s%.0f", current > 0 ? ", " : "",
+                    counts[counter]);
+            }
+            fprintf(file, "]");
+        }
+        #endif
+        fprintf(file, "}%s\n", phase < NUM_PROFILE_PHASES - 1 ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+/*
+    profile_report()
+        Prints the time of each phase, summed over the days from the
+        slowest thread, and its mean imbalance over the days it ran,
+        then writes every slot to the profile file
+*/
+void profile_report(struct global_t *global)
+{
+    const char *file_name = getenv("PANDEMIC_PROFILE");
+    FILE *file;
+    int phase;
+    int length;
+    #ifdef PERF_COUNTERS
+    int counter;
+    double counts[NUM_COUNTERS];
+    #endif
+
+    printf("Profile phase\tseconds\timbalance");
+    #ifdef PERF_COUNTERS
+    printf("\tcycles\tinstructions\tIPC\tLLC_misses\tbranch_misses");
+    #endif
+    printf("\n");
+    for(phase = 0; phase <= NUM_PROFILE_PHASES - 1; phase++)
+    {
+        double seconds;
+        double imbalance;
+
+        if(profile_totals(global, phase, &seconds, &imbalance) > 0)
+        {
+            printf("%s\t%lf\t%lf", profile_name(phase), seconds,
+                imbalance);
+            #ifdef PERF_COUNTERS
+            // the counts of all the threads, "-" if a counter did not
+            // open
+            profile_phase_counts(global, phase, -1, counts);
+            for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+            {
+                if(counter_status[counter] == 1)
+                {
+                    printf("\t%.0f", counts[counter]);
+                }
+                else
+                {
+                    printf("\t-");
+                }
+                if(counter == COUNTER_INSTRUCTIONS)
+                {
+                    if(counter_status[COUNTER_CYCLES] == 1
+                        && counter_status[COUNTER_INSTRUCTIONS] == 1
+                        && counts[COUNTER_CYCLES] > 0.0)
+                    {
+                        printf("\t%.2f", counts[COUNTER_INSTRUCTIONS]
+                            / counts[COUNTER_CYCLES]);
+                    }
+                    else
+                    {
+                        printf("\t-");
+                    }
+                }
+            }
+            #endif
+            printf("\n");
+        }
+    }
+    #ifdef PERF_COUNTERS
+    // one line when the kernel refused them all, as in a container
+    if(!counters_any())
+    {
+        printf("Hardware counters unavailable: %s\n",
+            strerror(counter_error));
+    }
+    else
+    {
+        for(counter = 0; counter <= NUM_COUNTERS - 1; counter++)
+        {
+            if(counter_status[counter] != 1)
+            {
+                printf("Counter %s unavailable: %s\n",
+                    counter_name(counter), strerror(counter_error));
+            }
+        }
+    }
+    #endif
+
+    if(file_name == NULL || file_name[0] == '\0')
+    {
+        file_name = "profile.csv";
+    }
+    file = fopen(file_name, "w");
+    if(file == NULL)
+    {
+        fprintf(stderr, "ERROR: cannot write the profile to %s\n", file_name);
+        return;
+    }
+    length = strlen(file_name);
+    if(length >= 5 && strcmp(file_name + length - 5, ".json") == 0)
+    {
+        profile_write_json(global, file);
+    }
+    else
+    {
+        profile_write_csv(global, file);
+    }
+    fclose(file);
+}
+#endif
+
+#endif
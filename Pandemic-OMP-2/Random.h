@@ -0,0 +1,60 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_RANDOM_H
+#define PANDEMIC_RANDOM_H
+
+// What a random number is used for -- part of its key, so that every
+// decision about a person gets its own number
+const int RANDOM_X_LOCATION = 0;
+const int RANDOM_Y_LOCATION = 1;
+const int RANDOM_X_MOVE = 2;
+const int RANDOM_Y_MOVE = 3;
+const int RANDOM_INFECTION = 4;
+const int RANDOM_DEATH = 5;
+
+unsigned long   random_mix(unsigned long value);
+int             random_int(unsigned long seed, int day, person_t person_id,
+                    int purpose, int bound);
+
+/*
+    random_mix()
+        Scrambles the bits of a 64 bit value (the finalizer of
+        splitmix64), so that keys that differ in a single bit give
+        unrelated results.
+*/
+unsigned long random_mix(unsigned long value)
+{
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9UL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebUL;
+    return(value ^ (value >> 31));
+}
+
+/*
+    random_int()
+        Returns a random number from 0 to bound - 1 for the given
+        seed, day, person and purpose. The number is computed from
+        its key alone (a counter-based generator), so there is no
+        stream to set up, split between threads or jump ahead: the
+        same run gives the same numbers with any number of threads.
+*/
+int random_int(unsigned long seed, int day, person_t person_id, int purpose,
+    int bound)
+{
+    unsigned long value;
+
+    value = random_mix(seed + 0x9e3779b97f4a7c15UL);
+    value = random_mix(value ^ ((unsigned long)person_id
+        * 0xd1b54a32d192ed03UL));
+    value = random_mix(value ^ ((((unsigned long)(unsigned int)day << 8)
+        | (unsigned long)purpose) * 0xaef17502108ef2d9UL));
+
+    // the high 32 bits scaled to [0, bound)
+    return((int)(((value >> 32) * (unsigned long)bound) >> 32));
+}
+
+#endif
@@ -0,0 +1,420 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_RENDER_H
+#define PANDEMIC_RENDER_H
+
+#include <stdio.h>      // for fopen, fwrite, snprintf
+#include <stdlib.h>     // for malloc, free
+#include <string.h>     // for strstr, strlen, strcmp, memset
+#include <errno.h>      // for errno
+#include <pthread.h>    // for the writer thread
+#include <omp.h>       // OpenMP
+
+/* Offscreen renderer, for movies of runs without an X server. With
+ * -v file, every -V days the threads draw the people into a frame of
+ * one byte per pixel, each thread its own people, with the colors of
+ * the X display: infected red, immune green, susceptible black, dead
+ * and empty white. A pixel of a large environment covers a square of
+ * locations and shows the most urgent state in it, infected before
+ * immune before susceptible before dead. A writer thread turns the
+ * frame into RGB and writes it while the next days run, into the other
+ * of two frames.
+ *
+ * A file name with a %d gets one PPM per frame, the first %d replaced
+ * by the day and the rest of the name kept as it is; a name ending in
+ * .rgb gets raw rgb24 frames one after the other
+ * (ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH); any other name gets the
+ * PPMs one after the other (ffmpeg -f image2pipe -c:v ppm). */
+
+// The longest side of a frame; larger environments are scaled down
+const int RENDER_MAX_SIDE = 1024;
+
+// Formats of the output
+const int RENDER_PPM_FILES = 0;
+const int RENDER_PPM_STREAM = 1;
+const int RENDER_RAW_STREAM = 2;
+
+// Levels of a pixel, the highest state drawn in it wins; the colors of
+// the levels
+const unsigned char RENDER_EMPTY = 0;
+const unsigned char RENDER_DEAD = 1;
+const unsigned char RENDER_SUSCEPTIBLE = 2;
+const unsigned char RENDER_IMMUNE = 3;
+const unsigned char RENDER_INFECTED = 4;
+const unsigned char RENDER_COLORS[5][3] = {{255, 255, 255},
+    {255, 255, 255}, {0, 0, 0}, {0, 255, 0}, {255, 0, 0}};
+
+// The frames and their writer
+struct render_t
+{
+    int width;
+    int height;
+    // locations per pixel along each side
+    int scale;
+    int format;
+    const char *file_name;
+    FILE *file;
+    // the frames the threads fill in turn, the day of each, and the
+    // RGB row the writer converts them with
+    unsigned char *frames[2];
+    int frame_days[2];
+    int pending[2];
+    int next_slot;
+    unsigned char *rgb;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int stop;
+    // time the threads spent drawing and waiting, time of the writer,
+    // frames written
+    double draw_time;
+    double write_time;
+    int num_frames;
+};
+
+void        render_start(struct global_t *global, struct const_t *constant);
+unsigned char render_level(char state);
+void        render_day(struct global_t *global, struct const_t *constant);
+void        render_day_team(struct global_t *global,
+                struct const_t *constant, int day);
+void        *render_writer(void *argument);
+void        render_write(struct render_t *render, unsigned char *frame,
+                int day);
+void        render_finish(struct global_t *global, double day_time);
+
+/*
+    render_start()
+        Sizes the frames of -v, opens the stream and starts the writer
+        thread
+*/
+void render_start(struct global_t *global, struct const_t *constant)
+{
+    struct render_t *render;
+    const char *file_name = constant->render_file;
+    int longest_side;
+    size_t length;
+
+    if(file_name == NULL)
+    {
+        return;
+    }
+
+    render = (struct render_t*)malloc(sizeof(struct render_t));
+    longest_side = constant->environment_width
+        > constant->environment_height ? constant->environment_width
+        : constant->environment_height;
+    render->scale = (longest_side + RENDER_MAX_SIDE - 1) / RENDER_MAX_SIDE;
+    render->width = (constant->environment_width + render->scale - 1)
+        / render->scale;
+    render->height = (constant->environment_height + render->scale - 1)
+        / render->scale;
+
+    length = strlen(file_name);
+    render->file_name = file_name;
+    render->file = NULL;
+    if(strstr(file_name, "%d") != NULL)
+    {
+        render->format = RENDER_PPM_FILES;
+    }
+    else
+    {
+        render->format = length >= 4
+            && strcmp(file_name + length - 4, ".rgb") == 0
+            ? RENDER_RAW_STREAM : RENDER_PPM_STREAM;
+        render->file = fopen(file_name, "wb");
+        if(render->file == NULL)
+        {
+            fprintf(stderr, "ERROR: cannot write the frames to %s: %s\n",
+                file_name, strerror(errno));
+            exit(-1);
+        }
+    }
+
+    render->frames[0] = (unsigned char*)malloc((long)render->width
+        * render->height);
+    render->frames[1] = (unsigned char*)malloc((long)render->width
+        * render->height);
+    render->pending[0] = 0;
+    render->pending[1] = 0;
+    render->next_slot = 0;
+    render->rgb = (unsigned char*)malloc((long)render->width * 3);
+    render->stop = 0;
+    render->draw_time = 0.0;
+    render->write_time = 0.0;
+    render->num_frames = 0;
+    pthread_mutex_init(&render->lock, NULL);
+    pthread_cond_init(&render->changed, NULL);
+    pthread_create(&render->writer, NULL, render_writer, render);
+
+    global->render = render;
+}
+
+/*
+    render_level()
+        Returns the level of a state
+*/
+unsigned char render_level(char state)
+{
+    if(state == INFECTED)
+    {
+        return(RENDER_INFECTED);
+    }
+    if(state == IMMUNE)
+    {
+        return(RENDER_IMMUNE);
+    }
+    if(state == SUSCEPTIBLE)
+    {
+        return(RENDER_SUSCEPTIBLE);
+    }
+    return(RENDER_DEAD);
+}
+
+/*
+    render_day()
+        Each process spawns threads to draw the day, if a frame is due
+*/
+void render_day(struct global_t *global, struct const_t *constant)
+{
+    int day = global->current_day;
+
+    if(global->render != NULL && day % constant->render_days == 0)
+    {
+        #ifdef _OPENMP
+        #pragma omp parallel
+        #endif
+        render_day_team(global, constant, day);
+    }
+}
+
+/*
+    render_day_team()
+        The threads of the current team wait for the writer to be done
+        with the frame before last, clear it, draw their people into it
+        and hand it to the writer, if a frame is due on the day. Called
+        by every thread of a parallel region, with the day each thread
+        runs.
+*/
+void render_day_team(struct global_t *global, struct const_t *constant,
+    int day)
+{
+    struct render_t *render = global->render;
+    unsigned char *frame;
+    long number_of_pixels;
+    long current_pixel;
+    person_t current_person_id;
+    int width;
+    int scale;
+    int slot;
+    double start_render = 0.0;
+
+    if(render == NULL || day % constant->render_days != 0)
+    {
+        return;
+    }
+    number_of_pixels = (long)render->width * render->height;
+    width = render->width;
+    scale = render->scale;
+
+    #ifdef _OPENMP
+    #pragma omp master
+    #endif
+    start_render = omp_get_wtime();
+
+    // every thread takes the slot the single saw
+    #ifdef _OPENMP
+    #pragma omp single
+    #endif
+    {
+    pthread_mutex_lock(&render->lock);
+    while(render->pending[render->next_slot])
+    {
+        pthread_cond_wait(&render->changed, &render->lock);
+    }
+    pthread_mutex_unlock(&render->lock);
+    }
+    slot = render->next_slot;
+    frame = render->frames[slot];
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_pixel = 0; current_pixel <= number_of_pixels - 1;
+        current_pixel++)
+    {
+        frame[current_pixel] = RENDER_EMPTY;
+    }
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id
+        <= global->number_of_people - 1; current_person_id++)
+    {
+        unsigned char level = render_level(person_state(global,
+            current_person_id));
+        unsigned char *pixel = &frame[(long)(person_y(global,
+            current_person_id) / scale) * width
+            + person_x(global, current_person_id) / scale];
+        unsigned char seen = __atomic_load_n(pixel, __ATOMIC_RELAXED);
+
+        // the highest level wins, whichever thread draws last
+        while(level > seen && !__atomic_compare_exchange_n(pixel, &seen,
+            level, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+        }
+    }
+
+    #ifdef _OPENMP
+    #pragma omp single
+    #endif
+    {
+    pthread_mutex_lock(&render->lock);
+    render->frame_days[slot] = day;
+    render->pending[slot] = 1;
+    render->next_slot = slot ^ 1;
+    pthread_cond_broadcast(&render->changed);
+    pthread_mutex_unlock(&render->lock);
+    }
+
+    #ifdef _OPENMP
+    #pragma omp master
+    #endif
+    render->draw_time += omp_get_wtime() - start_render;
+}
+
+/*
+    render_writer()
+        The writer thread writes the frames in the order of their days
+        until it is stopped and has none left
+*/
+void *render_writer(void *argument)
+{
+    struct render_t *render = (struct render_t*)argument;
+    int slot = 0;
+
+    pthread_mutex_lock(&render->lock);
+    while(1)
+    {
+        while(!render->pending[slot] && !render->stop)
+        {
+            pthread_cond_wait(&render->changed, &render->lock);
+        }
+        if(!render->pending[slot])
+        {
+            break;
+        }
+        pthread_mutex_unlock(&render->lock);
+
+        double start_write = omp_get_wtime();
+        render_write(render, render->frames[slot], render->frame_days[slot]);
+
+        pthread_mutex_lock(&render->lock);
+        render->write_time += omp_get_wtime() - start_write;
+        render->num_frames++;
+        render->pending[slot] = 0;
+        pthread_cond_broadcast(&render->changed);
+        slot ^= 1;
+    }
+    pthread_mutex_unlock(&render->lock);
+
+    return(NULL);
+}
+
+/*
+    render_write()
+        Converts a frame to RGB a row at a time and writes it
+*/
+void render_write(struct render_t *render, unsigned char *frame, int day)
+{
+    FILE *file = render->file;
+    int current_row;
+    int current_column;
+
+    if(render->format == RENDER_PPM_FILES)
+    {
+        char file_name[4096];
+        const char *placeholder = strstr(render->file_name, "%d");
+
+        // the name is never a format, only its placeholder is replaced
+        snprintf(file_name, sizeof(file_name), "%.*s%d%s",
+            (int)(placeholder - render->file_name), render->file_name, day,
+            placeholder + 2);
+        file = fopen(file_name, "wb");
+        if(file == NULL)
+        {
+            fprintf(stderr, "ERROR: cannot write the frame to %s: %s\n",
+                file_name, strerror(errno));
+            return;
+        }
+    }
+    if(render->format != RENDER_RAW_STREAM)
+    {
+        fprintf(file, "P6\n%d %d\n255\n", render->width, render->height);
+    }
+
+    for(current_row = 0; current_row <= render->height - 1; current_row++)
+    {
+        unsigned char *row = frame + (long)current_row * render->width;
+
+        for(current_column = 0; current_column <= render->width - 1;
+            current_column++)
+        {
+            memcpy(render->rgb + current_column * 3,
+                RENDER_COLORS[row[current_column]], 3);
+        }
+        fwrite(render->rgb, 3, render->width, file);
+    }
+
+    if(render->format == RENDER_PPM_FILES)
+    {
+        fclose(file);
+    }
+}
+
+/*
+    render_finish()
+        Stops the writer once it has written every frame and reports
+*/
+void render_finish(struct global_t *global, double day_time)
+{
+    struct render_t *render = global->render;
+    double start_finish = omp_get_wtime();
+
+    if(render == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&render->lock);
+    render->stop = 1;
+    pthread_cond_broadcast(&render->changed);
+    pthread_mutex_unlock(&render->lock);
+    pthread_join(render->writer, NULL);
+    render->draw_time += omp_get_wtime() - start_finish;
+    if(render->file != NULL)
+    {
+        fclose(render->file);
+    }
+
+    printf("Render: %d frames of %d x %d to %s, draw time %lf (%.2lf%% of the days), writer time %lf\n",
+        render->num_frames, render->width, render->height, render->file_name,
+        render->draw_time,
+        day_time > 0.0 ? 100.0 * render->draw_time / day_time : 0.0,
+        render->write_time);
+
+    pthread_mutex_destroy(&render->lock);
+    pthread_cond_destroy(&render->changed);
+    free(render->frames[0]);
+    free(render->frames[1]);
+    free(render->rgb);
+    free(render);
+    global->render = NULL;
+}
+
+#endif
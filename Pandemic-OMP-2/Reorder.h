@@ -0,0 +1,321 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_REORDER_H
+#define PANDEMIC_REORDER_H
+
+#include <algorithm>    // for std::sort, std::inplace_merge
+#include <parallel/algorithm>   // for __gnu_parallel::sort
+#include <omp.h>       // OpenMP
+
+#include "People.h"    // for the locations and states of people
+
+/* Every reorder_days days the people are sorted by the Morton (Z-order)
+ * key of their location, so people who are close in the environment
+ * are close in memory, and the active infected list is rebuilt in the
+ * new order. person_ids keeps the id each person started with: the
+ * random numbers are keyed on it, so a run gives the same results
+ * whether or not it reorders. */
+
+unsigned long   morton_key(int x, int y);
+bool        reorder_less(const struct reorder_key_t &first,
+                const struct reorder_key_t &second);
+int         reorder_day(struct global_t *global, struct const_t *constant);
+void        reorder(struct global_t *global, struct const_t *constant);
+void        reorder_team(struct global_t *global, struct const_t *constant);
+void        reorder_keys_team(struct global_t *global);
+void        reorder_sort_team(struct global_t *global);
+void        reorder_people_team(struct global_t *global);
+template <typename value_t>
+void        reorder_array_team(struct global_t *global, value_t *array);
+
+/*
+    morton_key()
+        Interleaves the bits of x and y, x in the even bits
+*/
+unsigned long morton_key(int x, int y)
+{
+    unsigned long spread[2] = {(unsigned int)x, (unsigned int)y};
+    int current;
+
+    for(current = 0; current <= 1; current++)
+    {
+        spread[current] = (spread[current] | (spread[current] << 16))
+            & 0x0000ffff0000ffffUL;
+        spread[current] = (spread[current] | (spread[current] << 8))
+            & 0x00ff00ff00ff00ffUL;
+        spread[current] = (spread[current] | (spread[current] << 4))
+            & 0x0f0f0f0f0f0f0f0fUL;
+        spread[current] = (spread[current] | (spread[current] << 2))
+            & 0x3333333333333333UL;
+        spread[current] = (spread[current] | (spread[current] << 1))
+            & 0x5555555555555555UL;
+    }
+    return(spread[0] | (spread[1] << 1));
+}
+
+/*
+    reorder_less()
+        Orders the keys by location, and people at the same location by
+        their current place, so the sort gives one order
+*/
+bool reorder_less(const struct reorder_key_t &first,
+    const struct reorder_key_t &second)
+{
+    return(first.key < second.key
+        || (first.key == second.key && first.person_id < second.person_id));
+}
+
+/*
+    reorder_day()
+        Returns 1 if the people are reordered at the start of the
+        current day
+*/
+int reorder_day(struct global_t *global, struct const_t *constant)
+{
+    return(constant->reorder_days > 0 && global->current_day > 0
+        && global->current_day % constant->reorder_days == 0);
+}
+
+/*
+    reorder()
+        Each process spawns threads to compute the keys, sorts them with
+        the parallel mode of the standard library, then spawns threads
+        to move the people to their new places
+*/
+void reorder(struct global_t *global, struct const_t *constant)
+{
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    reorder_keys_team(global);
+
+    __gnu_parallel::sort(global->reorder_keys,
+        global->reorder_keys + global->number_of_people, reorder_less);
+
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    reorder_people_team(global);
+}
+
+/*
+    reorder_team()
+        reorder() for the threads of the current team. A nested team
+        would not get threads here, so the team sorts the keys itself
+        with reorder_sort_team().
+*/
+void reorder_team(struct global_t *global, struct const_t *constant)
+{
+    reorder_keys_team(global);
+    reorder_sort_team(global);
+    reorder_people_team(global);
+}
+
+/*
+    reorder_keys_team()
+        The threads compute the sort key of every person
+*/
+void reorder_keys_team(struct global_t *global)
+{
+    person_t current_person_id;
+    person_t number_of_people = global->number_of_people;
+
+    struct reorder_key_t *reorder_keys = global->reorder_keys;
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        reorder_keys[current_person_id].key = morton_key(
+            person_x(global, current_person_id),
+            person_y(global, current_person_id));
+        reorder_keys[current_person_id].person_id = current_person_id;
+    }
+}
+
+/*
+    reorder_sort_team()
+        The threads sort the keys: each thread sorts its thread_block(),
+        then the sorted blocks are merged in pairs, a pass at a time,
+        until one run is left. std::inplace_merge borrows a buffer as
+        long as the shorter run, and merges without one if it cannot.
+*/
+void reorder_sort_team(struct global_t *global)
+{
+    struct reorder_key_t *reorder_keys = global->reorder_keys;
+    long number_of_people = global->number_of_people;
+    person_t first;
+    person_t last;
+    int rank = 0;
+    int threads = 1;
+    int width;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    threads = omp_get_num_threads();
+    #endif
+
+    thread_block(number_of_people, &first, &last);
+    std::sort(reorder_keys + first, reorder_keys + last, reorder_less);
+
+    // Pass width merges the runs of width blocks starting at the ranks
+    // that are multiples of 2 * width with the run after them
+    for(width = 1; width < threads; width *= 2)
+    {
+        #ifdef _OPENMP
+        #pragma omp barrier
+        #endif
+        if(rank % (2 * width) == 0 && rank + width < threads)
+        {
+            int end = rank + 2 * width < threads ? rank + 2 * width
+                : threads;
+
+            std::inplace_merge(
+                reorder_keys + number_of_people * rank / threads,
+                reorder_keys + number_of_people * (rank + width) / threads,
+                reorder_keys + number_of_people * end / threads,
+                reorder_less);
+        }
+    }
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #endif
+}
+
+/*
+    reorder_people_team()
+        The threads move the data of every person to its place in the
+        sorted keys, one array at a time through reorder_scratch, then
+        rebuild the active infected list
+*/
+void reorder_people_team(struct global_t *global)
+{
+    person_t current_person_id;
+    person_t number_of_people = global->number_of_people;
+
+    // pointers to arrays in global struct
+    struct reorder_key_t *reorder_keys = global->reorder_keys;
+    person_t *reorder_scratch = global->reorder_scratch;
+    person_t *person_ids = global->person_ids;
+    days_t *num_days_infected = global->num_days_infected;
+
+    // locations
+    #ifdef COMPACT_LAYOUT
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        reorder_scratch[current_person_id] = global->locations[
+            reorder_keys[current_person_id].person_id];
+    }
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        global->locations[current_person_id] =
+            (unsigned int)reorder_scratch[current_person_id];
+    }
+    #else
+    reorder_array_team(global, global->x_locations);
+    reorder_array_team(global, global->y_locations);
+    #endif
+
+    // states
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        reorder_scratch[current_person_id] = person_state(global,
+            reorder_keys[current_person_id].person_id);
+    }
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        set_person_state(global, current_person_id,
+            (char)reorder_scratch[current_person_id]);
+    }
+
+    // days infected
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        reorder_scratch[current_person_id] = num_days_infected[
+            reorder_keys[current_person_id].person_id];
+    }
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        num_days_infected[current_person_id] =
+            (days_t)reorder_scratch[current_person_id];
+    }
+
+    // where the people are stamped in the infection field
+    if(global->stamped_x_locations != NULL)
+    {
+        reorder_array_team(global, global->stamped_x_locations);
+        reorder_array_team(global, global->stamped_y_locations);
+    }
+
+    // first ids
+    reorder_array_team(global, person_ids);
+
+    // The active infected list in the new order
+    list_infected_team(global);
+}
+
+/*
+    reorder_array_team()
+        The threads move the values of an array of the people, of ints
+        or ids, to their places in the sorted keys
+*/
+template <typename value_t>
+void reorder_array_team(struct global_t *global, value_t *array)
+{
+    person_t current_person_id;
+    person_t number_of_people = global->number_of_people;
+
+    struct reorder_key_t *reorder_keys = global->reorder_keys;
+    person_t *reorder_scratch = global->reorder_scratch;
+
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        reorder_scratch[current_person_id] =
+            array[reorder_keys[current_person_id].person_id];
+    }
+    #ifdef _OPENMP
+    #pragma omp for
+    #endif
+    for(current_person_id = 0; current_person_id <= number_of_people - 1;
+        current_person_id++)
+    {
+        array[current_person_id] = (value_t)reorder_scratch[current_person_id];
+    }
+}
+
+#endif
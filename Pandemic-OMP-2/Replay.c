@@ -0,0 +1,124 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+/* Replay reader: rebuilds days of a run from the archive written with
+ * -z, without running the model.
+ *
+ * Usage: Pandemic-replay archive_file first_day [last_day [people_file]]
+ *
+ * Prints the counts of each state on every day from first_day to
+ * last_day (first_day alone if no last_day) as CSV, and writes every
+ * person of last_day to people_file: first id, x, y, state and days
+ * infected. */
+
+#include <stdio.h>      // for printf
+#include <stdlib.h>     // for atoi, exit
+#include <omp.h>
+
+#include "Defaults.h"
+#include "People.h"
+#include "Archive.h"
+
+void        print_counts(struct archive_reader_t *reader, int day);
+void        write_people(struct archive_reader_t *reader,
+                const char *file_name);
+
+/*
+    print_counts()
+        Prints the counts of each state of the day the reader holds
+*/
+void print_counts(struct archive_reader_t *reader, int day)
+{
+    long counts[4] = {0, 0, 0, 0};
+    long current_person_id;
+
+    for(current_person_id = 0; current_person_id
+        <= reader->header.number_of_people - 1; current_person_id++)
+    {
+        char state = reader->frame.states[current_person_id];
+
+        counts[0] += state == SUSCEPTIBLE;
+        counts[1] += state == INFECTED;
+        counts[2] += state == IMMUNE;
+        counts[3] += state == DEAD;
+    }
+    printf("%d,%ld,%ld,%ld,%ld\n", day, counts[0], counts[1], counts[2],
+        counts[3]);
+}
+
+/*
+    write_people()
+        Writes every person of the day the reader holds
+*/
+void write_people(struct archive_reader_t *reader, const char *file_name)
+{
+    FILE *file = fopen(file_name, "w");
+    struct archive_frame_t *frame = &reader->frame;
+    long current_person_id;
+
+    if(file == NULL)
+    {
+        fprintf(stderr, "ERROR: cannot write %s\n", file_name);
+        exit(-1);
+    }
+    fprintf(file, "id,x,y,state,days_infected\n");
+    for(current_person_id = 0; current_person_id
+        <= reader->header.number_of_people - 1; current_person_id++)
+    {
+        fprintf(file, "%ld,%d,%d,%c,%d\n", current_person_id,
+            frame->x_locations[current_person_id],
+            frame->y_locations[current_person_id],
+            frame->states[current_person_id],
+            frame->num_days_infected[current_person_id]);
+    }
+    fclose(file);
+}
+
+int main(int argc, char ** argv)
+{
+    struct archive_reader_t reader;
+    int first_day;
+    int last_day;
+    int day;
+
+    if(argc < 3)
+    {
+        fprintf(stderr, "Usage: %s archive_file first_day [last_day [people_file]]\n",
+            argv[0]);
+        exit(-1);
+    }
+    first_day = atoi(argv[2]);
+    last_day = argc > 3 ? atoi(argv[3]) : first_day;
+
+    if(archive_open(&reader, argv[1]) != 0)
+    {
+        exit(-1);
+    }
+
+    double start_replay = omp_get_wtime();
+    printf("day,susceptible,infected,immune,dead\n");
+    for(day = first_day; day <= last_day; day++)
+    {
+        if(archive_seek(&reader, day) != 0)
+        {
+            fprintf(stderr, "ERROR: %s has no day %d (days %d to %d)\n",
+                argv[1], day, reader.header.first_day,
+                reader.header.first_day + reader.header.num_days - 1);
+            exit(-1);
+        }
+        print_counts(&reader, day);
+    }
+    fprintf(stderr, "Replay time: %lf\n", omp_get_wtime() - start_replay);
+
+    if(argc > 4)
+    {
+        write_people(&reader, argv[4]);
+    }
+
+    archive_close(&reader);
+    exit(EXIT_SUCCESS);
+}
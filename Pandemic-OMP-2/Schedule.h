@@ -0,0 +1,351 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_SCHEDULE_H
+#define PANDEMIC_SCHEDULE_H
+
+#include <stdio.h>      // for fprintf
+#include <limits.h>     // for INT_MAX
+#include <omp.h>       // OpenMP
+
+/* Schedules of the loops over the people in move() and susceptible().
+ * Without -A both use static blocks of people, one per thread. With -A
+ * every thread times its share of the two phases, and the scheduler
+ * tries each candidate schedule for a day, keeps the one with the
+ * fastest slowest thread, and tries them all again when the infected
+ * fraction has doubled or halved since, as the work per person
+ * changes with it. The chunk size of the candidates is fitted to the
+ * time a person took on the day with the static schedule. */
+
+// Candidates the scheduler tries, in order: the static schedule comes
+// first so the chunk can be fitted to its times
+const int SCHEDULE_KINDS[NUM_SCHEDULE_CANDIDATES] = {SCHEDULE_STATIC,
+    SCHEDULE_DYNAMIC, SCHEDULE_DYNAMIC, SCHEDULE_GUIDED};
+const int SCHEDULE_CHUNK_FACTORS[NUM_SCHEDULE_CANDIDATES] = {0, 1, 4, 1};
+
+// Time a chunk should take, and the bounds of the chunk size in people
+const double SCHEDULE_CHUNK_SECONDS = 20e-6;
+const int SCHEDULE_MIN_CHUNK = 16;
+
+// Change of the infected fraction below which the schedules are not
+// tried again
+const double SCHEDULE_MIN_FRACTION_CHANGE = 0.01;
+
+const char  *schedule_name(int kind);
+const char  *phase_name(int phase);
+void        schedule_reset(struct global_t *global, struct const_t *constant);
+void        schedule_candidate(struct global_t *global, int phase,
+                int candidate);
+person_t    schedule_slice_size(struct global_t *global, int phase);
+void        schedule_loop_team(struct global_t *global, int phase,
+                person_t chunk);
+void        schedule_done_team(struct global_t *global,
+                struct const_t *constant, int phase, double start);
+void        schedule_update(struct global_t *global,
+                struct const_t *constant, int phase);
+void        schedule_report(struct global_t *global,
+                struct const_t *constant);
+
+/*
+    schedule_name()
+        Returns the name of the schedule
+*/
+const char *schedule_name(int kind)
+{
+    if(kind == SCHEDULE_DYNAMIC)
+    {
+        return("dynamic");
+    }
+    else if(kind == SCHEDULE_GUIDED)
+    {
+        return("guided");
+    }
+    return("static");
+}
+
+/*
+    phase_name()
+        Returns the name of the phase
+*/
+const char *phase_name(int phase)
+{
+    if(phase == PHASE_MOVE)
+    {
+        return("move");
+    }
+    return("susceptible");
+}
+
+/*
+    schedule_reset()
+        Starts every phase with the static schedule; with -A the
+        scheduler starts by trying the candidates
+*/
+void schedule_reset(struct global_t *global, struct const_t *constant)
+{
+    int phase;
+
+    for(phase = 0; phase <= NUM_PHASES - 1; phase++)
+    {
+        struct schedule_t *schedule = &global->schedules[phase];
+
+        schedule->kind = SCHEDULE_STATIC;
+        schedule->chunk_size = 0;
+        schedule->trial = constant->adaptive_schedule ? 0 : -1;
+        schedule->fitted_chunk = SCHEDULE_MIN_CHUNK;
+        schedule->chosen_fraction = 0.0;
+        schedule->static_imbalance = 0.0;
+        schedule->static_days = 0;
+        schedule->chosen_imbalance = 0.0;
+        schedule->chosen_days = 0;
+    }
+}
+
+/*
+    schedule_candidate()
+        Gives the phase the schedule of the candidate
+*/
+void schedule_candidate(struct global_t *global, int phase, int candidate)
+{
+    struct schedule_t *schedule = &global->schedules[phase];
+
+    schedule->kind = SCHEDULE_KINDS[candidate];
+    schedule->chunk_size = SCHEDULE_CHUNK_FACTORS[candidate]
+        * schedule->fitted_chunk;
+}
+
+/*
+    schedule_slice_size()
+        Returns the number of people the threads of the current team
+        take at a time in the phase: a block per thread with the static
+        schedule, a chunk otherwise
+*/
+person_t schedule_slice_size(struct global_t *global, int phase)
+{
+    int threads = 1;
+    person_t number_of_people = global->number_of_people;
+
+    #ifdef _OPENMP
+    threads = omp_get_num_threads();
+    #endif
+
+    if(global->schedules[phase].chunk_size > 0)
+    {
+        return(global->schedules[phase].chunk_size);
+    }
+    return(number_of_people > threads ?
+        (number_of_people + threads - 1) / threads : 1);
+}
+
+/*
+    schedule_loop_team()
+        Sets the schedule the next schedule(runtime) loop of the calling
+        thread uses to the one of the phase, handing out chunk
+        iterations at a time. Every thread of the team calls it, so they
+        all agree on the schedule.
+*/
+void schedule_loop_team(struct global_t *global, int phase, person_t chunk)
+{
+    #ifdef _OPENMP
+    int kind = global->schedules[phase].kind;
+
+    // the chunk of the runtime schedule is an int
+    if(chunk > INT_MAX)
+    {
+        chunk = INT_MAX;
+    }
+
+    if(kind == SCHEDULE_DYNAMIC)
+    {
+        omp_set_schedule(omp_sched_dynamic, (int)chunk);
+    }
+    else if(kind == SCHEDULE_GUIDED)
+    {
+        omp_set_schedule(omp_sched_guided, (int)chunk);
+    }
+    else
+    {
+        omp_set_schedule(omp_sched_static, 0);
+    }
+    #endif
+}
+
+/*
+    schedule_done_team()
+        Each thread of the team records how long it worked on the
+        phase since start, then one thread updates the schedule. Ends
+        with the threads together, so it also closes a nowait loop.
+*/
+void schedule_done_team(struct global_t *global, struct const_t *constant,
+    int phase, double start)
+{
+    int rank = 0;
+
+    #ifdef _OPENMP
+    rank = omp_get_thread_num();
+    #endif
+
+    if(global->busy_times == NULL)
+    {
+        #ifdef _OPENMP
+        #pragma omp barrier
+        #endif
+        return;
+    }
+
+    global->busy_times[rank] = omp_get_wtime() - start;
+
+    #ifdef _OPENMP
+    #pragma omp barrier
+    #pragma omp single
+    #endif
+    schedule_update(global, constant, phase);
+}
+
+/*
+    schedule_update()
+        Measures the imbalance of the phase today and picks the
+        schedule of the phase for tomorrow
+*/
+void schedule_update(struct global_t *global, struct const_t *constant,
+    int phase)
+{
+    struct schedule_t *schedule = &global->schedules[phase];
+    int threads = 1;
+    person_t number_of_people = global->number_of_people;
+    int current;
+    double slowest = 0.0;
+    double total = 0.0;
+    double imbalance = 1.0;
+    double fraction = number_of_people > 0 ?
+        (double)global->num_infected / number_of_people : 0.0;
+
+    #ifdef _OPENMP
+    threads = omp_get_num_threads();
+    #endif
+
+    // The slowest thread over the mean of the threads
+    for(current = 0; current <= threads - 1; current++)
+    {
+        total += global->busy_times[current];
+        if(global->busy_times[current] > slowest)
+        {
+            slowest = global->busy_times[current];
+        }
+    }
+    if(total > 0.0)
+    {
+        imbalance = slowest * threads / total;
+    }
+    if(schedule->kind == SCHEDULE_STATIC)
+    {
+        schedule->static_imbalance += imbalance;
+        schedule->static_days++;
+    }
+
+    // Keep the chosen schedule until the infected fraction has doubled
+    // or halved
+    if(schedule->trial < 0)
+    {
+        schedule->chosen_imbalance += imbalance;
+        schedule->chosen_days++;
+        if((fraction > 2.0 * schedule->chosen_fraction
+            || fraction < 0.5 * schedule->chosen_fraction)
+            && (fraction - schedule->chosen_fraction
+                > SCHEDULE_MIN_FRACTION_CHANGE
+            || schedule->chosen_fraction - fraction
+                > SCHEDULE_MIN_FRACTION_CHANGE))
+        {
+            fprintf(stderr, "day %d %s: infected fraction %.3f -> %.3f, trying the schedules again\n",
+                global->current_day, phase_name(phase),
+                schedule->chosen_fraction, fraction);
+            schedule->trial = 0;
+            schedule_candidate(global, phase, 0);
+        }
+        return;
+    }
+
+    // Otherwise today was a trial. The static day fits the chunk: the
+    // number of people that take SCHEDULE_CHUNK_SECONDS
+    schedule->trial_times[schedule->trial] = slowest;
+    if(schedule->trial == 0)
+    {
+        double per_person = number_of_people > 0 ?
+            total / number_of_people : 0.0;
+        long chunk = per_person > 0.0 ?
+            (long)(SCHEDULE_CHUNK_SECONDS / per_person) : SCHEDULE_MIN_CHUNK;
+        long largest = number_of_people / threads;
+
+        chunk = chunk < largest ? chunk : largest;
+        chunk = chunk > SCHEDULE_MIN_CHUNK ? chunk : SCHEDULE_MIN_CHUNK;
+        schedule->fitted_chunk = (person_t)chunk;
+    }
+    schedule->trial++;
+
+    if(schedule->trial <= NUM_SCHEDULE_CANDIDATES - 1)
+    {
+        schedule_candidate(global, phase, schedule->trial);
+    }
+    else
+    {
+        int best = 0;
+
+        for(current = 1; current <= NUM_SCHEDULE_CANDIDATES - 1; current++)
+        {
+            if(schedule->trial_times[current] < schedule->trial_times[best])
+            {
+                best = current;
+            }
+        }
+        schedule_candidate(global, phase, best);
+        schedule->trial = -1;
+        schedule->chosen_fraction = fraction;
+
+        fprintf(stderr, "day %d %s: %s", global->current_day,
+            phase_name(phase), schedule_name(schedule->kind));
+        if(schedule->chunk_size > 0)
+        {
+            fprintf(stderr, " chunk %ld", (long)schedule->chunk_size);
+        }
+        fprintf(stderr, " (");
+        for(current = 0; current <= NUM_SCHEDULE_CANDIDATES - 1; current++)
+        {
+            fprintf(stderr, "%s%s %ld %.6lf s", current > 0 ? ", " : "",
+                schedule_name(SCHEDULE_KINDS[current]),
+                (long)SCHEDULE_CHUNK_FACTORS[current] * schedule->fitted_chunk,
+                schedule->trial_times[current]);
+        }
+        fprintf(stderr, ")\n");
+    }
+}
+
+/*
+    schedule_report()
+        Prints the mean imbalance of each phase on the days with the
+        static schedule and on the days with the chosen schedule
+*/
+void schedule_report(struct global_t *global, struct const_t *constant)
+{
+    int phase;
+
+    if(!constant->adaptive_schedule)
+    {
+        return;
+    }
+    for(phase = 0; phase <= NUM_PHASES - 1; phase++)
+    {
+        struct schedule_t *schedule = &global->schedules[phase];
+
+        printf("Imbalance of %s: static %lf, adaptive %lf\n", phase_name(phase),
+            schedule->static_days > 0 ?
+                schedule->static_imbalance / schedule->static_days : 0.0,
+            schedule->chosen_days > 0 ?
+                schedule->chosen_imbalance / schedule->chosen_days : 0.0);
+    }
+}
+
+#endif
@@ -0,0 +1,264 @@
+/* Parallelization: Infectious Disease
+ * By Aaron Weeden, Shodor Education Foundation, Inc.
+ * November 2011
+ * Modified by Yu Zhao, Macalester College.
+ * July 2013
+ * (Modularized and restructured the original code) */
+
+#ifndef PANDEMIC_SERIES_H
+#define PANDEMIC_SERIES_H
+
+#include <stdio.h>      // for fopen, fwrite
+#include <stdlib.h>     // for malloc, free
+#include <string.h>     // for strlen, strcmp, strerror
+#include <errno.h>      // for errno
+#include <time.h>       // for nanosleep
+#include <sched.h>      // for sched_yield
+#include <pthread.h>    // for the writer thread
+
+/* Time series of the run. With -o file, the master thread pushes one
+ * record per day (the counts of each state and the people infected on
+ * the day, the drop in susceptible people) into a ring with one
+ * producer and one consumer, which costs the day a few stores. A writer
+ * thread takes every record in the ring at once, formats the batch and
+ * writes it, then sleeps until the next poll; the day loop never waits
+ * on it unless the ring is full. A file ending in .bin gets the records
+ * as they are after a small header, any other file gets CSV. */
+
+// Records of the ring, a power of 2
+const int SERIES_RING_SIZE = 4096;
+// How long the writer sleeps when the ring is empty
+const long SERIES_POLL_NANOSECONDS = 1000000;
+// Header of the binary series: the magic, then the version and the
+// size of a record as ints
+const char SERIES_MAGIC[8] = {'P', 'A', 'N', 'D', 'S', 'E', 'R', 'I'};
+const int SERIES_VERSION = 2;
+
+// One day of the series, as longs so that the binary series is the
+// same whatever the size of person_t
+struct day_record_t
+{
+    long day;
+    long num_susceptible;
+    long num_infected;
+    long num_immune;
+    long num_dead;
+    long incidence;
+};
+
+// The ring and its writer
+struct series_t
+{
+    struct day_record_t *ring;
+    // the master writes head, the writer writes tail; both only grow
+    unsigned long head;
+    unsigned long tail;
+    int stop;
+    // susceptible people at the end of the last day pushed
+    person_t last_susceptible;
+    FILE *file;
+    int binary;
+    pthread_t writer;
+    // records written, times the ring was full, time of the writer
+    long num_written;
+    long num_stalls;
+    double write_time;
+};
+
+void        series_start(struct global_t *global, struct const_t *constant);
+void        series_push(struct global_t *global, int day);
+void        *series_writer(void *argument);
+long        series_drain(struct series_t *series, char *batch);
+void        series_finish(struct global_t *global, struct const_t *constant);
+
+/*
+    series_start()
+        Opens the series file of -o and starts the writer thread
+*/
+void series_start(struct global_t *global, struct const_t *constant)
+{
+    struct series_t *series;
+    const char *file_name = constant->series_file;
+    size_t length;
+
+    if(file_name == NULL)
+    {
+        return;
+    }
+
+    series = (struct series_t*)malloc(sizeof(struct series_t));
+    series->ring = (struct day_record_t*)malloc(SERIES_RING_SIZE
+        * sizeof(struct day_record_t));
+    series->head = 0;
+    series->tail = 0;
+    series->stop = 0;
+    series->last_susceptible = global->num_susceptible;
+    series->num_written = 0;
+    series->num_stalls = 0;
+    series->write_time = 0.0;
+
+    length = strlen(file_name);
+    series->binary = length >= 4
+        && strcmp(file_name + length - 4, ".bin") == 0;
+    series->file = fopen(file_name, series->binary ? "wb" : "w");
+    if(series->file == NULL)
+    {
+        fprintf(stderr, "ERROR: cannot write the series to %s: %s\n",
+            file_name, strerror(errno));
+        exit(-1);
+    }
+    if(series->binary)
+    {
+        int header[2] = {SERIES_VERSION, (int)sizeof(struct day_record_t)};
+
+        fwrite(SERIES_MAGIC, sizeof(SERIES_MAGIC), 1, series->file);
+        fwrite(header, sizeof(header), 1, series->file);
+    }
+    else
+    {
+        fprintf(series->file,
+            "day,susceptible,infected,immune,dead,incidence\n");
+    }
+
+    pthread_create(&series->writer, NULL, series_writer, series);
+    global->series = series;
+}
+
+/*
+    series_push()
+        Puts the counts at the end of the day in the ring. Called by one
+        thread, after the last phase of the day.
+*/
+void series_push(struct global_t *global, int day)
+{
+    struct series_t *series = global->series;
+    struct day_record_t *record;
+    unsigned long head;
+
+    if(series == NULL)
+    {
+        return;
+    }
+
+    head = series->head;
+    // only a ring the writer has fallen a whole ring behind on waits
+    while(head - __atomic_load_n(&series->tail, __ATOMIC_ACQUIRE)
+        >= (unsigned long)SERIES_RING_SIZE)
+    {
+        series->num_stalls++;
+        sched_yield();
+    }
+
+    record = &series->ring[head & (SERIES_RING_SIZE - 1)];
+    record->day = day;
+    record->num_susceptible = global->num_susceptible;
+    record->num_infected = global->num_infected;
+    record->num_immune = global->num_immune;
+    record->num_dead = global->num_dead;
+    record->incidence = series->last_susceptible - global->num_susceptible;
+    series->last_susceptible = global->num_susceptible;
+
+    __atomic_store_n(&series->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+    series_writer()
+        The writer thread writes the records in the ring in batches
+        until it is stopped and the ring is empty
+*/
+void *series_writer(void *argument)
+{
+    struct series_t *series = (struct series_t*)argument;
+    struct timespec poll = {0, SERIES_POLL_NANOSECONDS};
+    // one line of CSV is at most 6 longs and their commas
+    char *batch = (char*)malloc(SERIES_RING_SIZE * 128);
+
+    while(1)
+    {
+        int stop = __atomic_load_n(&series->stop, __ATOMIC_ACQUIRE);
+        double start_write = omp_get_wtime();
+        long size = series_drain(series, batch);
+
+        if(size > 0)
+        {
+            fwrite(batch, 1, size, series->file);
+            series->write_time += omp_get_wtime() - start_write;
+        }
+        else if(stop)
+        {
+            // stop was seen before the ring was found empty
+            break;
+        }
+        else
+        {
+            nanosleep(&poll, NULL);
+        }
+    }
+    free(batch);
+
+    return(NULL);
+}
+
+/*
+    series_drain()
+        Formats every record in the ring into the batch and frees their
+        slots. Returns the size of the batch.
+*/
+long series_drain(struct series_t *series, char *batch)
+{
+    unsigned long head = __atomic_load_n(&series->head, __ATOMIC_ACQUIRE);
+    unsigned long tail = series->tail;
+    long size = 0;
+
+    for(; tail != head; tail++)
+    {
+        struct day_record_t *record =
+            &series->ring[tail & (SERIES_RING_SIZE - 1)];
+
+        if(series->binary)
+        {
+            memcpy(batch + size, record, sizeof(struct day_record_t));
+            size += sizeof(struct day_record_t);
+        }
+        else
+        {
+            size += sprintf(batch + size, "%ld,%ld,%ld,%ld,%ld,%ld\n",
+                record->day,
+                record->num_susceptible, record->num_infected,
+                record->num_immune, record->num_dead, record->incidence);
+        }
+        series->num_written++;
+    }
+    __atomic_store_n(&series->tail, tail, __ATOMIC_RELEASE);
+
+    return(size);
+}
+
+/*
+    series_finish()
+        Stops the writer once it has written every record, closes the
+        file and reports
+*/
+void series_finish(struct global_t *global, struct const_t *constant)
+{
+    struct series_t *series = global->series;
+
+    if(series == NULL)
+    {
+        return;
+    }
+
+    __atomic_store_n(&series->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(series->writer, NULL);
+    fclose(series->file);
+
+    printf("Series: %ld days written to %s in %lf, ring full %ld times\n",
+        series->num_written, constant->series_file, series->write_time,
+        series->num_stalls);
+
+    free(series->ring);
+    free(series);
+    global->series = NULL;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#!/bin/bash
+
+# Compares the ways the X display draws a frame (-x rects, -x image)
+# under Xvfb, so no screen is needed, and prints the time per frame of
+# each so the results can be copied into the spreadsheet.
+
+# Usage:
+#          bash ./run_display_tests.sh 3 "1000 10000" > display_tests.tsv
+#    will draw 1000 and 10000 people 3 times each way
+
+# Notes: 1. the program must be built with X_DISPLAY, and with X_SHM for
+#           the image to go through MIT-SHM (Makefile).
+#        2. the environment is 100 x 100 (a 1000 x 1000 window) and the
+#           days are not slowed down (-m 0); set PROBLEM to change them.
+#        3. the columns are the mean and the longest time of a frame in
+#           ms, and the drawing the program used ("shared image" when
+#           MIT-SHM worked).
+num_times=$1
+people_counts=${2:-"1000 10000"}
+problem=${PROBLEM:-"-w 100 -h 100 -t 100 -m 0"}
+
+if ! command -v xvfb-run > /dev/null
+then
+  echo "xvfb-run not found (install Xvfb)" >&2
+  exit 1
+fi
+
+printf "trial\tpeople\tdraw\tframe_ms\tmax_frame_ms\tdrawing\n"
+
+for people in $people_counts
+do
+  for draw in rects image
+  do
+    counter=1
+    while [ $counter -le $num_times ]
+    do
+      xvfb-run -a -s "-screen 0 1280x1024x24" \
+        ./Pandemic-openmp -n $people $problem -x $draw 2>/dev/null \
+        | awk -v trial=$counter -v people=$people -v draw=$draw '
+          /^X display/ {
+            drawing = $3 == "(shared" ? "shared image" : $3
+            gsub(/[():]/, "", drawing)
+            for(i = 1; i <= NF; i++) {
+              if($i == "per")
+                mean = $(i - 2)
+              if($i == "(max")
+                longest = $(i + 1)
+            }
+            printf "%d\t%d\t%s\t%s\t%s\t%s\n", trial, people, draw, mean,
+              longest, drawing
+          }'
+      ((counter++))
+    done
+  done
+done
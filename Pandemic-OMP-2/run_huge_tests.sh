@@ -0,0 +1,105 @@
+#!/bin/bash
+
+# Runs billions of people for a few days and checks each run against a
+# time budget, so the results can be copied into the spreadsheet.
+
+# Usage:
+#          bash ./run_huge_tests.sh 1 "4000000000 8000000000" 64 > huge_tests.tsv
+#    will run 4 and 8 billion people once each with 64 threads
+#          BUDGET=900 DAYS=5 PROBLEM="-w 20000 -h 20000 -i 1000" \
+#            bash ./run_huge_tests.sh 1 "100000000" 1
+#    will run 100 million people for 5 days on one thread in a smaller
+#    environment, a trial that fits a small machine (about 3 GB)
+
+# Notes: 1. the program must be built with HUGE_POPULATION and
+#           COMPACT_LAYOUT (Makefile); without HUGE_POPULATION it stops
+#           at 2^31-1 people.
+#        2. each person takes about 20 bytes, the pages of the arrays
+#           the days touch. With -a, first_touch() touches every page
+#           allocated, about 33 bytes a person, and -r sorts a copy of
+#           the arrays, about 40; set BYTES_PER_PERSON for those. The
+#           grid takes 16 bytes per cell of infection_radius square
+#           (-d, 3 by default): 7.6 GB for the default 65536 x 65536
+#           environment, so 8 billion people need about 170 GB. A run
+#           that does not fit in the available memory is skipped, not
+#           swapped.
+#        3. the susceptible phase costs about 0.2 us per person and day
+#           on one core, so 8 billion people for 10 days take about
+#           16000 s of core time: 4 to 5 minutes on 64 cores. BUDGET
+#           (seconds, default 1800) is the wall time a run has, from the
+#           start of the program to its end, initialization included.
+#        4. the columns are the wall time, the time of the days the
+#           program prints last, the peak memory in GB and whether the
+#           run kept within the budget; the peak memory is "-" without
+#           GNU time (/usr/bin/time).
+#        5. a run that fails (killed for memory, say) is FAILED instead,
+#           and the script exits with 1 once every run is done.
+num_times=$1
+people_counts=${2:-"4000000000 8000000000"}
+num_threads=${3:-$(nproc)}
+num_days=${DAYS:-10}
+budget=${BUDGET:-1800}
+problem=${PROBLEM:-"-w 65536 -h 65536 -i 100000"}
+bytes_per_person=${BYTES_PER_PERSON:-20}
+
+available_kb=$(awk '/^MemAvailable:/ { print $2 }' /proc/meminfo)
+
+# the grid of the problem, one cell per infection_radius square
+grid_kb=$(printf "%s\n" "$problem" | awk '{
+    width = 1000; height = 1000; radius = 3
+    for(i = 1; i < NF; i++) {
+      if($i == "-w") width = $(i + 1)
+      if($i == "-h") height = $(i + 1)
+      if($i == "-d") radius = $(i + 1)
+    }
+    if(radius < 1) radius = 1
+    cells = int((width + radius - 1) / radius) * int((height + radius - 1) / radius)
+    printf "%.0f", cells * 16 / 1024
+  }')
+failed=0
+
+# the peak memory comes from GNU time, when it is installed
+timer=()
+if [ -x /usr/bin/time ]
+then
+  timer=(/usr/bin/time -f "PEAK_KB %M")
+fi
+
+printf "trial\tpeople\tthreads\tdays\twall_time\tday_time\tpeak_GB\tbudget\n"
+
+for people in $people_counts
+do
+  needed_kb=$(awk -v people=$people -v bytes=$bytes_per_person \
+    -v grid=$grid_kb 'BEGIN { printf "%.0f", people * bytes / 1024 + grid }')
+  if [ $needed_kb -gt $available_kb ]
+  then
+    echo "$people people need about $((needed_kb / 1048576)) GB, $((available_kb / 1048576)) GB available: skipped" >&2
+    continue
+  fi
+
+  counter=1
+  while [ $counter -le $num_times ]
+  do
+    start=$(date +%s.%N)
+    output=$("${timer[@]}" ./Pandemic-openmp -p$num_threads \
+      -n $people -t $num_days $problem 2>&1)
+    status=$?
+    end=$(date +%s.%N)
+
+    wall_time=$(awk -v start=$start -v end=$end 'BEGIN { printf "%.1f", end - start }')
+    day_time=$(printf "%s\n" "$output" | awk -F'\t' '/^[0-9.]+(\t|$)/ { print $1 }')
+    peak_gb=$(printf "%s\n" "$output" | awk '/^PEAK_KB/ { printf "%.1f", $2 / 1048576 }')
+    within=$(awk -v wall=$wall_time -v budget=$budget 'BEGIN { print wall <= budget ? "within" : "OVER" }')
+    if [ $status -ne 0 ] || [ -z "$day_time" ]
+    then
+      within="FAILED"
+      failed=1
+      echo "$people people: the program exited with status $status" >&2
+    fi
+
+    printf "$counter\t$people\t$num_threads\t$num_days\t$wall_time\t${day_time:--}\t${peak_gb:--}\t$within\n"
+    ((counter++))
+  done
+done
+
+exit $failed
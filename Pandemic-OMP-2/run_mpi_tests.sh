@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# Runs the MPI version with a series of process counts on this machine,
+# checks that every count gives the same results, and prints the
+# communication/compute split so it can be copied into the spreadsheet.
+
+# Usage:
+#          make mpi
+#          bash ./run_mpi_tests.sh 3 "1 2 4" 2 > mpi_tests.tsv
+#    will run the problem below 3 times with 1, 2 and 4 processes of
+#    2 threads each
+
+# Notes: 1. set MPIRUN to change how the processes are started, e.g.
+#           MPIRUN="mpirun --oversubscribe" when there are fewer cores
+#           than processes times threads.
+#        2. the compute and communication times are the averages over
+#           the processes; the time a process waits for a slower
+#           neighbour counts as communication.
+#        3. the script exits with 1 if a run's final counts differ from
+#           those of the first run.
+num_times=$1
+process_counts=${2:-"1 2 4"}
+num_threads=${3:-1}
+mpirun=${MPIRUN:-mpirun}
+
+# the problem
+problem="-n 200000 -w 2000 -h 2000 -i 200 -t 250"
+
+printf "trial\tprocesses\tthreads\tcompute\tcommunication\ttime\n"
+expected=""
+status=0
+
+for num_processes in $process_counts
+do
+  counter=1
+  while [ $counter -le $num_times ]
+  do
+    output=$($mpirun -np $num_processes ./Pandemic-mpi -p$num_threads $problem)
+
+    counts=$(printf "%s\n" "$output" | grep "^final counts")
+    compute=$(printf "%s\n" "$output" | awk '/^Compute time/ { print $3 }')
+    communication=$(printf "%s\n" "$output" | awk '/^Communication time/ { print $3 }')
+    time=$(printf "%s\n" "$output" | awk -F'\t' '/^[0-9.]+\t/ { print $1 }')
+
+    if [ -z "$expected" ]
+    then
+      expected=$counts
+    elif [ "$counts" != "$expected" ]
+    then
+      echo "MISMATCH with $num_processes processes: $counts" >&2
+      status=1
+    fi
+
+    printf "$counter\t$num_processes\t$num_threads\t$compute\t$communication\t$time\n"
+    ((counter++))
+  done
+done
+
+echo "$expected" >&2
+exit $status
@@ -0,0 +1,67 @@
+#!/bin/bash
+
+# Compares the default placement with the NUMA-aware placement (-a) so the
+# results can be copied into the spreadsheet.
+
+# Usage:
+#          bash ./run_numa_tests.sh 5 "8 16 32" > numa_tests.tsv
+#    will run the problem below 5 times with and without -a for 8, 16
+#    and 32 threads
+
+# Notes: 1. the time column is the total time the program prints last.
+#        2. if perf can read the node-loads and node-load-misses events,
+#           the loads served by another socket are counted as well; every
+#           one moves a 64 byte cache line across the socket link, which
+#           gives the remote traffic in MB. Otherwise these columns are "-".
+#        3. the placement map printed by -a goes to numa_placement.txt.
+num_times=$1
+thread_counts=${2:-"2 4 8 16"}
+
+# the problem: large enough that the person arrays do not fit in cache
+problem="-n 2000000 -w 4000 -h 4000 -i 20000 -t 100"
+
+use_perf=0
+if perf stat -x, -e node-loads,node-load-misses true 2>&1 \
+    | grep -q "^[0-9]*,,node-loads"
+then
+  use_perf=1
+fi
+
+printf "trial\tthreads\tplacement\ttime\tnode_loads\tremote_loads\tremote_MB\n"
+rm -f numa_placement.txt
+
+for num_threads in $thread_counts
+do
+  for placement in default numa
+  do
+    flags=""
+    if [ $placement = numa ]
+    then
+      flags="-a"
+    fi
+
+    counter=1
+    while [ $counter -le $num_times ]
+    do
+      command="./Pandemic-openmp -p$num_threads $problem $flags"
+      if [ $use_perf = 1 ]
+      then
+        output=$(perf stat -x, -o perf.tmp -e node-loads,node-load-misses \
+          $command 2>>numa_placement.txt)
+        loads=$(awk -F, '$3 == "node-loads" { print $1 }' perf.tmp)
+        remote=$(awk -F, '$3 == "node-load-misses" { print $1 }' perf.tmp)
+        remote_mb=$(awk -v remote=$remote 'BEGIN { printf "%.1f", remote * 64 / 1048576 }')
+        rm -f perf.tmp
+      else
+        output=$($command 2>>numa_placement.txt)
+        loads="-"
+        remote="-"
+        remote_mb="-"
+      fi
+      time=$(printf "%s\n" "$output" | awk -F'\t' '/^[0-9.]+\t/ { print $1 }')
+
+      printf "$counter\t$num_threads\t$placement\t$time\t$loads\t$remote\t$remote_mb\n"
+      ((counter++))
+    done
+  done
+done
@@ -0,0 +1,177 @@
+#!/bin/bash
+
+# Runs strong or weak scaling tests over a matrix of thread counts,
+# numbers of people and numbers of days, writes the times in the layout
+# of strong_tests.tsv / weak_tests.tsv so they can be copied into the
+# spreadsheet, and summarizes every point of the matrix.
+
+# Usage:
+#          bash ./run_scaling_tests.sh strong 5 "1 2 4 8 16" "50000 200000" "250" > strong_tests.tsv
+#    will run 50000 and 200000 people for 250 days 5 times with each
+#    thread count, and
+#          bash ./run_scaling_tests.sh weak 5 "1 2 4 8 16" "50000" "250" > weak_tests.tsv
+#    will run 50000 people per thread for 250 days 5 times with each
+#    thread count
+
+# Notes: 1. the environment is square and grows with the people, so every
+#           problem has the density of the default one (50000 people on
+#           1000 x 1000); set DENSITY to change it.
+#        2. every point is first run WARMUPS times (1 by default) without
+#           being recorded.
+#        3. set PROBLEM to pass more options to every run, e.g.
+#           PROBLEM="-e brute -P", and PROGRAM to run another binary.
+#        4. the summary goes to SUMMARY (strong_summary.tsv or
+#           weak_summary.tsv by default), one line per point:
+#              median    the median time
+#              ci_low, ci_high   a 95% confidence interval of the median
+#                        from the order statistics of the times (the
+#                        lowest and highest time for fewer than 6 runs)
+#              speedup   the median time of the fewest threads times
+#                        their number over the median time (strong), or
+#                        the number of threads times the efficiency (weak)
+#              efficiency   the speedup over the number of threads
+#              karp_flatt   the serial fraction (1/speedup - 1/threads)
+#                        / (1 - 1/threads), "-" for one thread
+#        5. the raw lines are: trial, threads and one time per number of
+#           people (strong), or trial, people, threads and time (weak),
+#           with a blank line after each set of days.
+mode=$1
+num_times=$2
+thread_counts=${3:-"1 2 4 8 16"}
+people_counts=${4:-"50000"}
+day_counts=${5:-"250"}
+warmups=${WARMUPS:-1}
+density=${DENSITY:-0.05}
+program=${PROGRAM:-./Pandemic-openmp}
+summary=${SUMMARY:-${mode}_summary.tsv}
+
+if [ "$mode" != strong ] && [ "$mode" != weak ] || [ -z "$num_times" ]
+then
+  echo "Usage: $0 strong|weak num_times [thread_counts] [people_counts] [day_counts]" >&2
+  exit 1
+fi
+
+# times.tmp holds one line per recorded run: days, people per problem,
+# threads, time
+rm -f times.tmp
+
+# run_once people threads days
+#    prints the total time of one run
+run_once() {
+  local side
+  side=$(awk -v people=$1 -v density=$density \
+    'BEGIN { side = sqrt(people / density); printf "%d", side == int(side) ? side : int(side) + 1 }')
+  $program -p$2 -n $1 -w $side -h $side -t $3 $PROBLEM 2>/dev/null \
+    | awk -F'\t' '/^[0-9.]+\t/ { print $1 }'
+}
+
+for num_days in $day_counts
+do
+  for num_threads in $thread_counts
+  do
+    # the problems of this thread count
+    problems=""
+    for people in $people_counts
+    do
+      if [ $mode = weak ]
+      then
+        problems="$problems $(( people * num_threads ))"
+      else
+        problems="$problems $people"
+      fi
+    done
+
+    for problem in $problems
+    do
+      counter=1
+      while [ $counter -le $warmups ]
+      do
+        run_once $problem $num_threads $num_days > /dev/null
+        ((counter++))
+      done
+    done
+
+    counter=1
+    while [ $counter -le $num_times ]
+    do
+      if [ $mode = strong ]
+      then
+        printf "$counter\t$num_threads\t"
+      fi
+
+      # people_index keeps the weak problems of the same base size
+      # together in the summary
+      people_index=0
+      for problem in $problems
+      do
+        time=$(run_once $problem $num_threads $num_days)
+        if [ $mode = strong ]
+        then
+          printf "$time\t"
+        else
+          printf "$counter\t$problem\t$num_threads\t$time\n"
+        fi
+        printf "$num_days\t$people_index\t$problem\t$num_threads\t$time\n" >> times.tmp
+        ((people_index++))
+      done
+
+      if [ $mode = strong ]
+      then
+        printf "\n"
+      fi
+      ((counter++))
+    done
+  done
+  printf "\n"
+done
+
+# The summary of every point: the times of a point are sorted, and the
+# first thread count of each problem is the baseline
+printf "mode\tdays\tpeople\tthreads\truns\tmedian\tci_low\tci_high\tspeedup\tefficiency\tkarp_flatt\n" > $summary
+sort -t$'\t' -k1,1n -k2,2n -k4,4n -k5,5g times.tmp | awk -F'\t' -v mode=$mode '
+  function flush(   n, low, high, median, speedup, efficiency, karp_flatt) {
+    n = count
+    if(n == 0)
+      return
+    median = n % 2 ? times[(n + 1) / 2] : (times[n / 2] + times[n / 2 + 1]) / 2
+    low = int(n / 2 - 0.98 * sqrt(n))
+    high = 1 + n / 2 + 0.98 * sqrt(n)
+    high = high == int(high) ? high : int(high) + 1
+    if(low < 1 || n < 6)
+      low = 1
+    if(high > n || n < 6)
+      high = n
+    if(!(key in base_time)) {
+      base_time[key] = median
+      base_threads[key] = threads
+    }
+    if(mode == "strong") {
+      speedup = base_time[key] * base_threads[key] / median
+      efficiency = speedup / threads
+    } else {
+      efficiency = base_time[key] / median
+      speedup = efficiency * threads
+    }
+    if(threads > 1 && speedup > 0)
+      karp_flatt = sprintf("%.4f", (1 / speedup - 1 / threads) / (1 - 1 / threads))
+    else
+      karp_flatt = "-"
+    printf "%s\t%d\t%d\t%d\t%d\t%.6f\t%.6f\t%.6f\t%.3f\t%.3f\t%s\n",
+      mode, days, people, threads, n, median, times[low], times[high],
+      speedup, efficiency, karp_flatt
+    count = 0
+  }
+  {
+    if(NR > 1 && ($1 != days || $2 != index_ || $4 != threads))
+      flush()
+    days = $1
+    index_ = $2
+    people = $3
+    threads = $4
+    key = days "\t" index_
+    times[++count] = $5
+  }
+  END { flush() }' >> $summary
+rm -f times.tmp
+
+echo "summary in $summary" >&2